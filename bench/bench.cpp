@@ -0,0 +1,188 @@
+#include "bench.h"
+#include <string.h>
+#include <stdlib.h>
+#include <atomic>
+#include <string>
+#include "fileop.h"
+#include "console.h"
+#include "util.h"
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+static std::atomic<uint64_t> alloc_count(0);
+static std::atomic<uint64_t> alloc_bytes(0);
+
+#ifdef __GLIBC__
+/* Interpose malloc so allocations from both C and C++ code are counted. */
+extern "C" {
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+	void __libc_free(void* ptr);
+	void* malloc(size_t size) {
+		alloc_count.fetch_add(1, std::memory_order_relaxed);
+		alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+		return __libc_malloc(size);
+	}
+	void* calloc(size_t n, size_t size) {
+		alloc_count.fetch_add(1, std::memory_order_relaxed);
+		alloc_bytes.fetch_add(n * size, std::memory_order_relaxed);
+		return __libc_calloc(n, size);
+	}
+	void* realloc(void* ptr, size_t size) {
+		alloc_count.fetch_add(1, std::memory_order_relaxed);
+		alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+		return __libc_realloc(ptr, size);
+	}
+	void free(void* ptr) {
+		__libc_free(ptr);
+	}
+}
+#else
+/* Only C++ allocations can be counted. */
+void* operator new(size_t size) {
+	alloc_count.fetch_add(1, std::memory_order_relaxed);
+	alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	void* p = malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+#endif
+
+void bench::getAllocations(uint64_t& count, uint64_t& bytes) {
+	count = alloc_count.load();
+	bytes = alloc_bytes.load();
+}
+
+void bench::report(context& ctx, const result& r) {
+	ctx.results.push_back(r);
+	if (ctx.json) return;
+	if (r.p50 > 0) {
+		printf("%-40s %10zu %14.1f ns/op   p50 %.2f ms   p95 %.2f ms   p99 %.2f ms\n", r.name.c_str(), r.iterations, r.ns_per_op, r.p50 / 1e6, r.p95 / 1e6, r.p99 / 1e6);
+	} else {
+		printf("%-40s %10zu %14.1f ns/op %10.2f allocs/op %12.1f B/op\n", r.name.c_str(), r.iterations, r.ns_per_op, r.allocs_per_op, r.bytes_per_op);
+	}
+	fflush(stdout);
+}
+
+void bench::note(const context& ctx, const char* name, const char* message) {
+	if (!want(ctx, name)) return;
+	fprintf(ctx.json ? stderr : stdout, "%-40s %s\n", name, message);
+}
+
+void printJson(const bench::context& ctx) {
+	printf("{\n\t\"results\": [");
+	for (auto i = ctx.results.begin(); i != ctx.results.end(); ++i) {
+		printf("%s\n\t\t{\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f", i == ctx.results.begin() ? "" : ",", i->name.c_str(), i->iterations, i->ns_per_op, i->allocs_per_op, i->bytes_per_op);
+		if (i->p50 > 0) printf(", \"p50_ns\": %.0f, \"p95_ns\": %.0f, \"p99_ns\": %.0f", i->p50, i->p95, i->p99);
+		putchar('}');
+	}
+	printf("\n\t]\n}\n");
+}
+
+void printHelp() {
+	printf("ffplay-starter-bench [options]\n\
+-n N			Run every benchmark N iterations instead of calibrating.\n\
+--min-time MS		Minimum measure time of every benchmark when calibrating. (Default: 200)\n\
+--max-entries N		The size of the biggest synthetic directory. (Default: 100000)\n\
+--vfs-entries N		The size of the biggest directory in memory file system. (Default: 1000000)\n\
+--filter STR		Only run benchmarks whose name contains STR.\n\
+--ffplay PATH		The ffplay used to benchmark prefetch.\n\
+--ffmpeg PATH		The ffmpeg used to measure filtergraphs and the first frame of subtitles. (Default: search in PATH)\n\
+--starter PATH		The ffplay-starter used by startup benchmarks. (Default: next to this program)\n\
+--fake-ffplay PATH	The fake ffplay used by startup benchmarks. (Default: next to this program)\n\
+--runs N		Run ffplay-starter N times in every startup benchmark. (Default: 20)\n\
+--budget MS		Exit with 2 if p95 of any startup benchmark is bigger than MS.\n\
+--json			Output results as JSON.\n");
+}
+
+int main(int argc, char* argv[]) {
+	bench::context ctx;
+	std::string ffplay;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--exit-now")) return 0;
+		bool hasarg = i + 1 < argc;
+		if (!strcmp(argv[i], "-n") && hasarg) {
+			ctx.iterations = (size_t)strtoull(argv[++i], nullptr, 10);
+		} else if (!strcmp(argv[i], "--min-time") && hasarg) {
+			ctx.min_time = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--max-entries") && hasarg) {
+			ctx.max_entries = (size_t)strtoull(argv[++i], nullptr, 10);
+		} else if (!strcmp(argv[i], "--vfs-entries") && hasarg) {
+			ctx.vfs_entries = (size_t)strtoull(argv[++i], nullptr, 10);
+		} else if (!strcmp(argv[i], "--filter") && hasarg) {
+			ctx.filter = argv[++i];
+		} else if (!strcmp(argv[i], "--ffplay") && hasarg) {
+			ffplay = argv[++i];
+		} else if (!strcmp(argv[i], "--ffmpeg") && hasarg) {
+			ctx.ffmpeg = argv[++i];
+		} else if (!strcmp(argv[i], "--starter") && hasarg) {
+			ctx.starter = argv[++i];
+		} else if (!strcmp(argv[i], "--fake-ffplay") && hasarg) {
+			ctx.fake_ffplay = argv[++i];
+		} else if (!strcmp(argv[i], "--runs") && hasarg) {
+			ctx.runs = (size_t)strtoull(argv[++i], nullptr, 10);
+		} else if (!strcmp(argv[i], "--budget") && hasarg) {
+			ctx.budget = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--json")) {
+			ctx.json = true;
+		} else {
+			printHelp();
+			return strcmp(argv[i], "-h") && strcmp(argv[i], "--help") ? 1 : 0;
+		}
+	}
+	console::set_log_level(console::QUIET_LOGLEVEL);
+	ctx.ffplay = fileop::which(ffplay.empty() ? "ffplay" : ffplay);
+	ctx.self = fileop::getProgramLocation();
+	if (ctx.self.empty()) {
+		fprintf(stderr, "Can not get program location.\n");
+		return 1;
+	}
+	std::string bindir;
+	fileop::split(ctx.self, &bindir, nullptr);
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	if (ctx.starter.empty()) ctx.starter = fileop::combilePath(bindir, "ffplay-starter.exe");
+	if (ctx.fake_ffplay.empty()) ctx.fake_ffplay = fileop::combilePath(bindir, "fake-ffplay.exe");
+#else
+	if (ctx.starter.empty()) ctx.starter = fileop::combilePath(bindir, "ffplay-starter");
+	if (ctx.fake_ffplay.empty()) ctx.fake_ffplay = fileop::combilePath(bindir, "fake-ffplay");
+#endif
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	auto tmp = getenv("TEMP");
+	std::string tmpbase = tmp ? tmp : ".";
+#else
+	auto tmp = getenv("TMPDIR");
+	std::string tmpbase = tmp ? tmp : "/tmp";
+#endif
+	ctx.tmpdir = fileop::combilePath(tmpbase, "ffplay-starter-bench-" + std::to_string(getpid()));
+	if (!fileop::mkdirs(ctx.tmpdir)) {
+		fprintf(stderr, "Can not create temporary directory %s.\n", ctx.tmpdir.c_str());
+		return 1;
+	}
+	/* Keep caches written by benchmarks away from the user's cache. */
+	auto cachedir = fileop::combilePath(ctx.tmpdir, "cache");
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	util::setEnv("LOCALAPPDATA", cachedir);
+#else
+	util::setEnv("XDG_CACHE_HOME", cachedir);
+#endif
+	bench::fileops(ctx);
+	bench::vfs(ctx);
+	bench::text(ctx);
+	bench::filters(ctx);
+	bench::subtitles(ctx);
+	bench::fonts(ctx);
+	bench::launch(ctx);
+	bool ok = bench::startup(ctx);
+	bench::removeTree(ctx.tmpdir);
+	if (ctx.json) printJson(ctx);
+	return ok ? 0 : 2;
+}
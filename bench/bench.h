@@ -0,0 +1,175 @@
+#ifndef _ST_BENCH_H
+#define _ST_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace bench {
+	typedef struct result {
+		std::string name;
+		size_t iterations = 0;
+		double ns_per_op = 0;
+		/// Heap allocations per operation
+		double allocs_per_op = 0;
+		/// Heap allocated bytes per operation
+		double bytes_per_op = 0;
+		/// Latency percentiles in nanoseconds, 0 if not measured
+		double p50 = 0;
+		double p95 = 0;
+		double p99 = 0;
+	} result;
+	typedef struct context {
+		/// Fixed iteration count, 0 means calibrate by min_time
+		size_t iterations = 0;
+		/// Minimum measure time in milliseconds when calibrating
+		int min_time = 200;
+		/// The max size of synthetic directories
+		size_t max_entries = 100000;
+		/// The max size of directories in memory file system
+		size_t vfs_entries = 1000000;
+		/// Only run benchmarks whose name contains this
+		std::string filter;
+		/// Output JSON instead of table
+		bool json = false;
+		/// The path to bench program itself
+		std::string self;
+		/// The path to real ffplay, may be empty
+		std::string ffplay;
+		/// The ffmpeg used to measure filtergraphs, searched in PATH if empty
+		std::string ffmpeg;
+		/// The path to ffplay-starter used by startup benchmarks
+		std::string starter;
+		/// The path to fake ffplay used by startup benchmarks
+		std::string fake_ffplay;
+		/// The count of ffplay-starter runs of every startup benchmark
+		size_t runs = 20;
+		/// Fail if p95 of any startup benchmark is bigger than this (milliseconds), 0 means no limit
+		double budget = 0;
+		/// Temporary directory used by benchmarks
+		std::string tmpdir;
+		std::vector<result> results;
+	} context;
+	/**
+	 * @brief Get monotonic time
+	 * @return time in nanoseconds
+	*/
+	inline uint64_t now() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	/**
+	 * @brief Get the count and the total size of heap allocations since program start
+	 * @param count Allocation count
+	 * @param bytes Allocated bytes
+	*/
+	void getAllocations(uint64_t& count, uint64_t& bytes);
+	/**
+	 * @brief Check whether a benchmark should run
+	 * @param ctx Context
+	 * @param name Benchmark name
+	 * @return true if should run
+	*/
+	inline bool want(const context& ctx, const std::string& name) {
+		return ctx.filter.empty() || name.find(ctx.filter) != std::string::npos;
+	}
+	/**
+	 * @brief Add a result and print it if output is table
+	 * @param ctx Context
+	 * @param r Result
+	*/
+	void report(context& ctx, const result& r);
+	/**
+	 * @brief Print a message to stderr, so JSON output is not broken
+	*/
+	void note(const context& ctx, const char* name, const char* message);
+	/**
+	 * @brief Run a function many times and measure time and heap allocations
+	 * @param ctx Context
+	 * @param name Benchmark name
+	 * @param f The function
+	*/
+	template <typename F>
+	void run(context& ctx, std::string name, F f) {
+		if (!want(ctx, name)) return;
+		f();
+		size_t iterations = ctx.iterations ? ctx.iterations : 1;
+		uint64_t elapsed = 0, count = 0, bytes = 0;
+		while (true) {
+			uint64_t c1, b1, c2, b2;
+			getAllocations(c1, b1);
+			auto start = now();
+			for (size_t i = 0; i < iterations; i++) f();
+			elapsed = now() - start;
+			getAllocations(c2, b2);
+			count = c2 - c1;
+			bytes = b2 - b1;
+			if (ctx.iterations || elapsed >= (uint64_t)ctx.min_time * 1000000) break;
+			/* Aim at min_time directly after the first round which is long enough to measure. */
+			if (elapsed > 1000000) {
+				auto next = (size_t)((double)iterations * ctx.min_time * 1000000 / elapsed * 1.1) + 1;
+				iterations = next > iterations ? next : iterations * 2;
+			} else {
+				iterations *= 10;
+			}
+		}
+		result r;
+		r.name = name;
+		r.iterations = iterations;
+		r.ns_per_op = (double)elapsed / iterations;
+		r.allocs_per_op = (double)count / iterations;
+		r.bytes_per_op = (double)bytes / iterations;
+		report(ctx, r);
+	}
+	/**
+	 * @brief Remove a directory created by benchmarks and all files in it
+	 * @param path The directory
+	*/
+	void removeTree(const std::string& path);
+	/**
+	 * @brief Create a directory like a season of a show: every episode has a video and some subtitles.
+	 * Its modification time is set to the past, like a directory in a media library.
+	 * @param dir The directory
+	 * @param entries The count of files
+	 * @return the path of a video in the middle of the directory, if failed, will be empty
+	*/
+	std::string createEpisodeDirectory(const std::string& dir, size_t entries);
+	/**
+	 * @brief Drop page cache, need root
+	 * @return true if OK
+	*/
+	bool dropCaches();
+	void fileops(context& ctx);
+	void text(context& ctx);
+	/**
+	 * @brief Benchmark detecting encodings of big subtitles from a bounded sample, and the cached result
+	*/
+	void charsets(context& ctx);
+	void launch(context& ctx);
+	/**
+	 * @brief Benchmark planning filtergraphs and the CPU time of rendering subtitles before and after scaling
+	*/
+	void filters(context& ctx);
+	/**
+	 * @brief Benchmark indexing and ranking external subtitles of a season directory
+	*/
+	void subtitles(context& ctx);
+	/**
+	 * @brief Benchmark resolving fonts of ASS subtitles and the first frame with all fonts or only the used ones
+	*/
+	void fonts(context& ctx);
+	/**
+	 * @brief Benchmark scanning code on an in-memory file system, free from disk noise
+	*/
+	void vfs(context& ctx);
+	/**
+	 * @brief Run ffplay-starter with fake ffplay and measure the time until ffplay starts
+	 * @param ctx Context
+	 * @return false if any p95 is over budget
+	*/
+	bool startup(context& ctx);
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "bench.h"
+#include <stdio.h>
+#include <string>
+#include "dirindex.h"
+#include "dirscan.h"
+#include "fileop.h"
+#include "pathview.h"
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#include <direct.h>
+#define rmdir _rmdir
+#else
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+void bench::removeTree(const std::string& path) {
+	filelist fl;
+	if (fileop::listdir(path, fl)) {
+		for (size_t i = 0; i < fl.size(); i++) {
+			if (remove(fl.c_str(i))) removeTree(fl.c_str(i));
+		}
+	}
+	rmdir(path.c_str());
+}
+
+std::string bench::createEpisodeDirectory(const std::string& dir, size_t entries) {
+	if (!fileop::mkdirs(dir)) return "";
+	const char* exts[] = { ".mkv", ".ass", ".sc.ass", ".tc.ass", ".srt" };
+	std::string target;
+	char name[128];
+	for (size_t i = 0; i < entries; i++) {
+		snprintf(name, sizeof(name), "[Group] Some Show - %06zu [1080p][HEVC]%s", i / 5, exts[i % 5]);
+		auto path = fileop::combilePath(dir, name);
+		auto f = fileop::open(path.c_str(), "wb");
+		if (!f) return "";
+		fileop::close(f);
+		if (i / 5 == entries / 10 && i % 5 == 0) target = path;
+	}
+	if (target.empty()) target = fileop::combilePath(dir, "[Group] Some Show - 000000 [1080p][HEVC].mkv");
+#if !defined(_WIN32) || defined(__CYGWIN__)
+	struct timeval times[2];
+	gettimeofday(&times[0], nullptr);
+	times[0].tv_sec -= 3600;
+	times[1] = times[0];
+	utimes(dir.c_str(), times);
+#endif
+	return target;
+}
+
+void bench::fileops(context& ctx) {
+	std::string path = "/mnt/media/anime/[Group] Some Show S01/[Group] Some Show - 01 [1080p][HEVC].mkv";
+	run(ctx, "fileop::splitext", [&]() {
+		std::string name, ext;
+		fileop::splitext(path, &name, &ext);
+	});
+	run(ctx, "fileop::split", [&]() {
+		std::string dir, name;
+		fileop::split(path, &dir, &name);
+	});
+	run(ctx, "fileop::combilePath", [&]() {
+		fileop::combilePath("/mnt/media/anime/[Group] Some Show S01", "[Group] Some Show - 01 [1080p][HEVC].sc.ass");
+	});
+	run(ctx, "pathview", [&]() {
+		pathview p(path);
+		if (p.ext().empty() || p.dir().empty()) path.clear();
+	});
+	std::string joined;
+	run(ctx, "pathview::join", [&]() {
+		joined.clear();
+		pathview::join(joined, "/mnt/media/anime/[Group] Some Show S01", "[Group] Some Show - 01 [1080p][HEVC].sc.ass");
+	});
+	for (size_t entries = 10; entries <= ctx.max_entries; entries *= 10) {
+		auto suffix = "/" + std::to_string(entries);
+		if (!want(ctx, "fileop::listrelative" + suffix) && !want(ctx, "fileop::filterFileListByExt" + suffix) && !want(ctx, "dirscan::scan" + suffix)) continue;
+		auto dir = fileop::combilePath(ctx.tmpdir, "dir" + std::to_string(entries));
+		auto target = createEpisodeDirectory(dir, entries);
+		if (target.empty()) {
+			note(ctx, ("fileop::listrelative" + suffix).c_str(), "skipped: can not create synthetic directory");
+			continue;
+		}
+		run(ctx, "fileop::listrelative" + suffix, [&]() {
+			filelist fl;
+			fileop::listrelative(target, fl, false);
+		});
+		dirscan scanner;
+		run(ctx, "dirscan::scan" + suffix, [&]() {
+			scanner.scan(dir);
+		});
+		fileop::fileid id;
+		if (want(ctx, "fileop::listrelative-index" + suffix) && scanner.scan(dir) && fileop::getFileId(dir, id) && dirindex::store(scanner, id)) {
+			run(ctx, "fileop::listrelative-index" + suffix, [&]() {
+				filelist fl;
+				fileop::listrelative(target, fl);
+			});
+		}
+		filelist all;
+		fileop::listdir(dir, all);
+		run(ctx, "fileop::filterFileListByExt" + suffix, [&]() {
+			filelist result;
+			fileop::filterFileListByExt(all, { "ass" }, result);
+		});
+		removeTree(dir);
+	}
+}
@@ -0,0 +1,101 @@
+#include "bench.h"
+#include <list>
+#include <string>
+#include "fileop.h"
+#include "filtergraph.h"
+#include "starter.h"
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <sys/resource.h>
+#endif
+
+#define FILTER_FRAMES 48
+
+/**
+ * @brief Write a subtitle script with several lines always on screen
+*/
+bool writeSubtitles(const std::string& path, const char* style) {
+	std::string s = "[Script Info]\nScriptType: v4.00+\nPlayResX: 1920\nPlayResY: 1080\n\n[V4+ Styles]\n\
+Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, \
+ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n";
+	s += style;
+	s += "\n\n[Events]\nFormat: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+	for (int i = 0; i < 4; i++) {
+		s += "Dialogue: 0,0:00:00.00,0:10:00.00,Default,,0,0," + std::to_string(60 + i * 70) + ",,{\\blur3}The quick brown fox jumps over the lazy dog " + std::to_string(i) + "\n";
+	}
+	return fileop::writeFile(path, s.c_str(), s.length());
+}
+
+/**
+ * @brief Get CPU time used by waited children
+ * @return time in nanoseconds
+*/
+uint64_t getChildrenCpuTime() {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	return 0;
+#else
+	struct rusage ru;
+	if (getrusage(RUSAGE_CHILDREN, &ru)) return 0;
+	return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL + (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+#endif
+}
+
+/**
+ * @brief Render 4K frames through a filtergraph with ffmpeg and report CPU time per frame
+ * @return false if ffmpeg failed
+*/
+bool benchRender(bench::context& ctx, const std::string& ffmpeg, const std::string& name, const std::string& graph) {
+	if (!bench::want(ctx, name)) return true;
+	std::list<std::string> args = { ffmpeg, "-hide_banner", "-nostdin", "-loglevel", "error", "-f", "lavfi", "-i",
+		"testsrc2=size=3840x2160:rate=24", "-frames:v", std::to_string(FILTER_FRAMES), "-vf", graph, "-f", "null", "-" };
+	size_t runs = ctx.iterations ? ctx.iterations : 3;
+	uint64_t cpu = 0;
+	for (size_t i = 0; i < runs; i++) {
+		auto start = getChildrenCpuTime();
+		if (fileop::run(args)) return false;
+		cpu += getChildrenCpuTime() - start;
+	}
+	bench::result r;
+	r.name = name;
+	r.iterations = runs * FILTER_FRAMES;
+	r.ns_per_op = (double)cpu / r.iterations;
+	bench::report(ctx, r);
+	return true;
+}
+
+void bench::filters(context& ctx) {
+	auto sub1 = fileop::combilePath(ctx.tmpdir, "show.ass");
+	auto sub2 = fileop::combilePath(ctx.tmpdir, "show.zh.ass");
+	run(ctx, "filtergraph/plan", [&]() {
+		filtergraph graph;
+		graph.add(filtergraph::RENDER, "subtitles=" + sub1);
+		graph.add(filtergraph::RENDER, "subtitles=" + sub2);
+		graph.add(filtergraph::GEOMETRY, filtergraph::scaleDown(1280));
+		graph.str();
+	});
+	if (!want(ctx, "filtergraph/render/")) return;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	note(ctx, "filtergraph/render", "skipped: CPU time of children is not supported");
+#else
+	auto ffmpeg = fileop::which(ctx.ffmpeg.empty() ? "ffmpeg" : ctx.ffmpeg);
+	if (ffmpeg.empty()) {
+		note(ctx, "filtergraph/render", "skipped: ffmpeg not found");
+		return;
+	}
+	const char* style = "Style: Default,Arial,64,&H00FFFFFF,&H000000FF,&H00000000,&H80000000,0,0,0,0,100,100,0,0,1,3,2,2,40,40,60,1";
+	if (!writeSubtitles(sub1, style) || !writeSubtitles(sub2, style)) {
+		note(ctx, "filtergraph/render", "skipped: can not write subtitles");
+		return;
+	}
+	auto subs = "subtitles=" + starter::escape(sub1) + ",subtitles=" + starter::escape(sub2);
+	filtergraph planned;
+	planned.add(filtergraph::RENDER, "subtitles=" + starter::escape(sub1));
+	planned.add(filtergraph::RENDER, "subtitles=" + starter::escape(sub2));
+	planned.add(filtergraph::GEOMETRY, filtergraph::scaleDown(1280));
+	/* The first one is the cost of generating and scaling frames, shared by both graphs. */
+	if (!benchRender(ctx, ffmpeg, "filtergraph/render/scale-only", filtergraph::scaleDown(1280))
+		|| !benchRender(ctx, ffmpeg, "filtergraph/render/subtitles-at-source", subs + "," + filtergraph::scaleDown(1280))
+		|| !benchRender(ctx, ffmpeg, "filtergraph/render/subtitles-at-output", planned.str())) {
+		note(ctx, "filtergraph/render", "skipped: ffmpeg failed, it may be built without subtitles filter");
+	}
+#endif
+}
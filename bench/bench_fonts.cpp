@@ -0,0 +1,160 @@
+#include "bench.h"
+#include <stdlib.h>
+#include <list>
+#include <string>
+#include "assfonts.h"
+#include "fileop.h"
+#include "starter.h"
+#include "util.h"
+
+#define FONTS_EVENTS 5000
+
+/**
+ * @brief Encode a font like ASS editors do: 4 characters for 3 bytes, 80 characters per line
+*/
+std::string uuencode(const std::string& data) {
+	std::string encoded, re;
+	auto s = (const unsigned char*)data.data();
+	for (size_t i = 0; i < data.length(); i += 3) {
+		size_t left = data.length() - i;
+		uint32_t v = (uint32_t)s[i] << 16 | (left > 1 ? (uint32_t)s[i + 1] << 8 : 0) | (left > 2 ? s[i + 2] : 0);
+		size_t chars = left > 2 ? 4 : left + 1;
+		for (size_t c = 0; c < chars; c++) encoded += (char)(((v >> (18 - c * 6)) & 63) + 33);
+	}
+	for (size_t i = 0; i < encoded.length(); i += 80) re += encoded.substr(i, 80) + "\n";
+	return re;
+}
+
+/**
+ * @brief Write a subtitle script like a fansub episode: a few styles, many events and some \fn overrides
+ * @param font A font embedded in [Fonts], empty to embed nothing
+*/
+bool writeFontsScript(const std::string& path, const std::string& font = "") {
+	std::string s = "[Script Info]\nScriptType: v4.00+\nPlayResX: 1920\nPlayResY: 1080\n\n[V4+ Styles]\n\
+Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, \
+ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n\
+Style: Default,DejaVu Sans,64,&H00FFFFFF,&H000000FF,&H00000000,&H80000000,0,0,0,0,100,100,0,0,1,3,2,2,40,40,60,1\n\
+Style: Top,DejaVu Serif,56,&H00FFFFFF,&H000000FF,&H00000000,&H80000000,0,0,0,0,100,100,0,0,1,3,2,8,40,40,60,1\n\
+Style: Sign,Some Missing Font,48,&H00FFFFFF,&H000000FF,&H00000000,&H80000000,0,0,0,0,100,100,0,0,1,3,2,5,40,40,60,1\n\
+\n[Events]\nFormat: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+	for (int i = 0; i < FONTS_EVENTS; i++) {
+		auto t = std::to_string(i % 60);
+		if (t.length() < 2) t = "0" + t;
+		s += "Dialogue: 0,0:" + std::to_string(i / 60 % 60) + ":" + t + ".00,0:10:00.00,";
+		if (i % 50 == 0) s += "Sign,,0,0,0,,{\\fnDejaVu Sans Mono\\b1\\pos(960,540)}Sign text " + std::to_string(i) + "\n";
+		else s += (i % 7 ? "Default" : "Top") + std::string(",,0,0,0,,{\\i1}The quick brown fox{\\i0} jumps over the lazy dog\\Nline ") + std::to_string(i) + "\n";
+	}
+	if (!font.empty()) s += "\n[Fonts]\nfontname: Embedded_0.ttf\n" + uuencode(font);
+	return fileop::writeFile(path, s.c_str(), s.length());
+}
+
+/**
+ * @brief Run ffmpeg rendering the first frame with subtitles on a cold fontconfig cache, report wall time
+ * @param prepared A directory from assfonts::prepare, empty to use all installed fonts
+*/
+void benchFirstFrame(bench::context& ctx, const std::string& ffmpeg, const std::string& name, const std::string& sub, const std::string& prepared) {
+	if (!bench::want(ctx, name)) return;
+	auto fontsdir = prepared.empty() ? "" : assfonts::getEmbeddedDir(prepared);
+	auto graph = "subtitles=" + starter::escape(sub) + (fontsdir.empty() ? "" : ":fontsdir=" + starter::escape(fontsdir));
+	std::list<std::string> args = { ffmpeg, "-hide_banner", "-nostdin", "-loglevel", "error", "-f", "lavfi", "-i",
+		"color=size=1920x1080:rate=24", "-frames:v", "1", "-vf", graph, "-f", "null", "-" };
+	auto fccache = fileop::combilePath(ctx.tmpdir, "fccache");
+	size_t runs = ctx.iterations ? ctx.iterations : 3;
+	uint64_t elapsed = 0;
+	for (size_t i = 0; i < runs; i++) {
+		/* fontconfig keeps its user cache in XDG_CACHE_HOME and the prepared one in the fonts directory. */
+		bench::removeTree(fccache);
+		if (!prepared.empty()) bench::removeTree(fileop::combilePath(prepared, "fccache"));
+		util::setEnv("XDG_CACHE_HOME", fccache);
+		util::setEnv("FONTCONFIG_FILE", prepared.empty() ? "" : assfonts::getConfigFile(prepared));
+		auto start = bench::now();
+		int code = fileop::run(args);
+		elapsed += bench::now() - start;
+		if (code) {
+			bench::note(ctx, name.c_str(), "skipped: ffmpeg failed, it may be built without subtitles filter");
+			return;
+		}
+	}
+	bench::result r;
+	r.name = name;
+	r.iterations = runs;
+	r.ns_per_op = (double)elapsed / runs;
+	bench::report(ctx, r);
+}
+
+void bench::fonts(context& ctx) {
+	if (!want(ctx, "fonts/")) return;
+	auto sub = fileop::combilePath(ctx.tmpdir, "fonts.ass");
+	if (!writeFontsScript(sub)) {
+		note(ctx, "fonts", "skipped: can not write subtitles");
+		return;
+	}
+	std::string data;
+	fileop::readFile(sub, data);
+	std::list<std::string> families;
+	std::string text;
+	run(ctx, "fonts/parse/" + std::to_string(FONTS_EVENTS), [&]() {
+		families.clear();
+		text.clear();
+		assfonts::getFamilies(data, families, &text);
+	});
+	std::list<std::string> files;
+	if (!assfonts::resolve(families, text, files)) {
+		note(ctx, "fonts", "skipped: built without fontconfig");
+		return;
+	}
+	run(ctx, "fonts/resolve", [&]() {
+		files.clear();
+		assfonts::resolve(families, text, files);
+	});
+	/* What every later start of the same episode costs. */
+	run(ctx, "fonts/prepare-cached", [&]() {
+		std::list<std::string> subs = { sub };
+		assfonts::prepare(subs);
+	});
+	/* A release embedding a real font, like most fansubs do. */
+	std::string font;
+	auto embedded = fileop::combilePath(ctx.tmpdir, "embedded.ass");
+	if (files.empty() || !fileop::readFile(files.front(), font) || !writeFontsScript(embedded, font)) {
+		note(ctx, "fonts/embedded", "skipped: can not write subtitles with an embedded font");
+		return;
+	}
+	std::string encoded, decoded;
+	fileop::readFile(embedded, data);
+	auto pos = data.find("[Fonts]");
+	for (size_t i = data.find('\n', data.find('\n', pos) + 1) + 1; i < data.length(); i++) {
+		if (data[i] != '\n') encoded += data[i];
+	}
+	run(ctx, "fonts/uudecode/" + std::to_string(font.length() / 1024) + "KiB", [&]() {
+		assfonts::uudecode(encoded, decoded);
+	});
+	if (decoded != font) note(ctx, "fonts/uudecode", "decoded font differs from the original");
+	/* Fonts were extracted by the first run, later ones only read the script. */
+	run(ctx, "fonts/scan-embedded", [&]() {
+		std::list<std::string> f, e;
+		std::string stripped;
+		assfonts::scan(embedded, f, nullptr, e, &stripped);
+	});
+	run(ctx, "fonts/prepare-cached-embedded", [&]() {
+		std::list<std::string> subs = { embedded };
+		assfonts::prepare(subs);
+	});
+	if (!want(ctx, "fonts/first-frame/")) return;
+	auto ffmpeg = fileop::which(ctx.ffmpeg.empty() ? "ffmpeg" : ctx.ffmpeg);
+	if (ffmpeg.empty()) {
+		note(ctx, "fonts/first-frame", "skipped: ffmpeg not found");
+		return;
+	}
+	std::list<std::string> subs = { sub }, stripped = { embedded };
+	auto prepared = assfonts::prepare(subs);
+	auto preparedEmbedded = assfonts::prepare(stripped);
+	auto cachedir = getenv("XDG_CACHE_HOME");
+	std::string saved = cachedir ? cachedir : "";
+	benchFirstFrame(ctx, ffmpeg, "fonts/first-frame/system", sub, "");
+	if (!prepared.empty()) benchFirstFrame(ctx, ffmpeg, "fonts/first-frame/prepared", sub, prepared);
+	/* libass decodes embedded fonts on every open, the stripped copy uses the extracted ones. */
+	benchFirstFrame(ctx, ffmpeg, "fonts/first-frame/embedded", embedded, "");
+	if (!preparedEmbedded.empty()) benchFirstFrame(ctx, ffmpeg, "fonts/first-frame/embedded-extracted", stripped.front(), preparedEmbedded);
+	util::setEnv("XDG_CACHE_HOME", saved);
+	util::setEnv("FONTCONFIG_FILE", "");
+}
@@ -0,0 +1,84 @@
+#include "bench.h"
+#include <list>
+#include <string>
+#include <thread>
+#include "fileop.h"
+#include "starter.h"
+#include "prefetch.h"
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <unistd.h>
+#endif
+
+bool bench::dropCaches() {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	return false;
+#else
+	sync();
+	auto f = fopen("/proc/sys/vm/drop_caches", "w");
+	if (!f) return false;
+	bool re = fputs("3", f) >= 0;
+	return fclose(f) == 0 && re;
+#endif
+}
+
+/**
+ * @brief Measure cold start time of ffplay -version with and without prefetching shared libraries.
+ * Starter's own setup is simulated by sleeping, prefetch runs in background during it.
+ * @param ctx Context
+ * @param iterations The count of iterations
+ * @param setup_ms Simulated setup time in milliseconds
+*/
+void benchPrefetch(bench::context& ctx, size_t iterations, int setup_ms) {
+	if (!bench::want(ctx, "prefetch/")) return;
+	if (ctx.ffplay.empty()) {
+		bench::note(ctx, "prefetch", "skipped: ffplay not found");
+		return;
+	}
+	if (!bench::dropCaches()) {
+		bench::note(ctx, "prefetch", "skipped: can not drop page cache (need root)");
+		return;
+	}
+	std::list<std::string> args = { ctx.ffplay, "-hide_banner", "-version" };
+	uint64_t cold = 0, warm = 0;
+	for (size_t i = 0; i < iterations; i++) {
+		bench::dropCaches();
+		std::this_thread::sleep_for(std::chrono::milliseconds(setup_ms));
+		auto start = bench::now();
+		fileop::run(args);
+		cold += bench::now() - start;
+		bench::dropCaches();
+		auto ffplay = ctx.ffplay;
+		std::thread t([ffplay]() {
+			prefetch::executable(ffplay);
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(setup_ms));
+		start = bench::now();
+		fileop::run(args);
+		warm += bench::now() - start;
+		t.join();
+	}
+	bench::result r;
+	r.iterations = iterations;
+	r.name = "prefetch/cold-exec";
+	r.ns_per_op = (double)cold / iterations;
+	bench::report(ctx, r);
+	r.name = "prefetch/prefetched-exec";
+	r.ns_per_op = (double)warm / iterations;
+	bench::report(ctx, r);
+}
+
+void bench::launch(context& ctx) {
+	/* The bench program itself is used as a fake ffplay which exits immediately. */
+	std::list<std::string> args = { ctx.self, "--exit-now", "-autoexit", "-x", "1280", "/tmp/not exists.mkv" };
+	auto command = starter::joinArguments(args);
+	run(ctx, "launch/system", [&]() {
+		fileop::system(command.c_str());
+	});
+	run(ctx, "launch/spawn", [&]() {
+		fileop::spawn(args);
+	});
+	run(ctx, "prefetch/closure", [&]() {
+		prefetch::getLibraryClosure(ctx.self);
+	});
+	benchPrefetch(ctx, 5, 50);
+}
@@ -0,0 +1,144 @@
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <list>
+#include <string>
+#include <vector>
+#include "fileop.h"
+#include "util.h"
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Put fake ffplay into a directory as ffplay
+ * @param fake The fake ffplay
+ * @param dir The directory
+ * @return true if OK
+*/
+bool installFakeFfplay(const std::string& fake, const std::string& dir) {
+	if (!fileop::mkdirs(dir)) return false;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	std::string data;
+	if (!fileop::readFile(fake, data, 256 * 1024 * 1024)) return false;
+	return fileop::writeFile(fileop::combilePath(dir, "ffplay.exe"), data.c_str(), data.length());
+#else
+	return !symlink(fake.c_str(), fileop::combilePath(dir, "ffplay").c_str());
+#endif
+}
+
+/**
+ * @brief Get the start time of the last fake ffplay invocation and remove the log
+ * @param log The log file written by fake ffplay
+ * @param video The video which should be the last argument
+ * @param time Result
+ * @return true if found
+*/
+bool readLaunchTime(const std::string& log, const std::string& video, uint64_t& time) {
+	std::string data;
+	if (!fileop::readFile(log, data)) return false;
+	remove(log.c_str());
+	while (!data.empty() && data.back() == '\n') data.pop_back();
+	auto line = data.substr(data.rfind('\n') == std::string::npos ? 0 : data.rfind('\n') + 1);
+	auto tab = line.rfind('\t');
+	if (tab == std::string::npos || line.substr(tab + 1) != video) return false;
+	time = strtoull(line.c_str(), nullptr, 10);
+	return time > 0;
+}
+
+/**
+ * @brief Get the percentile of sorted samples by nearest rank
+*/
+double percentile(const std::vector<uint64_t>& sorted, double p) {
+	size_t rank = (size_t)(p / 100 * sorted.size() + 0.999999);
+	if (rank < 1) rank = 1;
+	if (rank > sorted.size()) rank = sorted.size();
+	return (double)sorted[rank - 1];
+}
+
+bool bench::startup(context& ctx) {
+	std::vector<size_t> sizes;
+	for (size_t entries = 10; entries <= ctx.max_entries && entries <= 10000; entries *= 10) {
+		auto suffix = "/" + std::to_string(entries);
+		if (want(ctx, "startup/cold" + suffix) || want(ctx, "startup/warm" + suffix)) sizes.push_back(entries);
+	}
+	if (sizes.empty()) return true;
+	if (!fileop::exists(ctx.starter) || !fileop::exists(ctx.fake_ffplay)) {
+		note(ctx, "startup", "skipped: ffplay-starter or fake-ffplay not found");
+		return true;
+	}
+	if (!ctx.runs) return true;
+	auto base = fileop::combilePath(ctx.tmpdir, "startup");
+	auto bindir = fileop::combilePath(base, "bin");
+	auto cachedir = fileop::combilePath(base, "cache");
+	auto log = fileop::combilePath(base, "ffplay.log");
+	if (!installFakeFfplay(ctx.fake_ffplay, bindir)) {
+		note(ctx, "startup", "skipped: can not install fake ffplay");
+		return true;
+	}
+	auto path = getenv("PATH");
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	util::setEnv("PATH", bindir + ";" + (path ? path : ""));
+	util::setEnv("LOCALAPPDATA", cachedir);
+#else
+	util::setEnv("PATH", bindir + ":" + (path ? path : ""));
+	util::setEnv("XDG_CACHE_HOME", cachedir);
+#endif
+	util::setEnv("FAKE_FFPLAY_LOG", log);
+	bool canDrop = dropCaches();
+	if (!canDrop) note(ctx, "startup/cold", "page cache is not dropped (need root), only probe cache is cleared");
+	bool ok = true;
+	for (auto entries : sizes) {
+		auto suffix = "/" + std::to_string(entries);
+		auto video = createEpisodeDirectory(fileop::combilePath(base, "media" + std::to_string(entries)), entries);
+		if (video.empty()) {
+			note(ctx, ("startup" + suffix).c_str(), "skipped: can not create synthetic directory");
+			continue;
+		}
+		std::list<std::string> args = { ctx.starter, video };
+		for (int warm = 0; warm < 2; warm++) {
+			auto name = (warm ? "startup/warm" : "startup/cold") + suffix;
+			if (!want(ctx, name)) continue;
+			/* Fill caches before the first warm run. */
+			if (warm) fileop::run(args);
+			remove(log.c_str());
+			std::vector<uint64_t> samples;
+			uint64_t total = 0;
+			for (size_t i = 0; i < ctx.runs; i++) {
+				if (!warm) {
+					removeTree(fileop::combilePath(cachedir, "ffplay-starter"));
+					if (canDrop) dropCaches();
+				}
+				auto start = now();
+				int code = fileop::run(args);
+				uint64_t launched;
+				if (code || !readLaunchTime(log, video, launched)) {
+					note(ctx, name.c_str(), ("failed: ffplay-starter exited with " + std::to_string(code) + " or did not start fake ffplay").c_str());
+					samples.clear();
+					break;
+				}
+				samples.push_back(launched - start);
+				total += launched - start;
+			}
+			if (samples.empty()) {
+				ok = false;
+				continue;
+			}
+			std::sort(samples.begin(), samples.end());
+			result r;
+			r.name = name;
+			r.iterations = samples.size();
+			r.ns_per_op = (double)total / samples.size();
+			r.p50 = percentile(samples, 50);
+			r.p95 = percentile(samples, 95);
+			r.p99 = percentile(samples, 99);
+			report(ctx, r);
+			if (ctx.budget > 0 && r.p95 > ctx.budget * 1e6) {
+				note(ctx, name.c_str(), "p95 is over budget");
+				ok = false;
+			}
+		}
+	}
+	return ok;
+}
@@ -0,0 +1,67 @@
+#include "bench.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "configfile.h"
+#include "fileop.h"
+#include "subresolver.h"
+
+/**
+ * @brief Create a season directory, every episode has subtitles next to it and in Subs/<stem>/
+ * @return paths of videos, empty if failed
+*/
+std::vector<std::string> createSeasonDirectory(const std::string& dir, size_t episodes) {
+	std::vector<std::string> videos;
+	const char* tags[] = { ".mkv", ".en.srt", ".zh.ass", ".en.forced.srt", ".ja.vtt", ".sup" };
+	const char* tracks[] = { "2_English.srt", "3_Chinese.ass", "4_English.sup" };
+	auto subs = fileop::combilePath(dir, "Subs");
+	char stem[64];
+	for (size_t i = 0; i < episodes; i++) {
+		snprintf(stem, sizeof(stem), "Some Show S01E%02zu 1080p", i + 1);
+		std::vector<std::string> files;
+		for (auto t : tags) files.push_back(fileop::combilePath(dir, stem + std::string(t)));
+		auto trackdir = fileop::combilePath(subs, stem);
+		if (!fileop::mkdirs(trackdir)) return {};
+		for (auto t : tracks) files.push_back(fileop::combilePath(trackdir, t));
+		for (auto f = files.begin(); f != files.end(); ++f) {
+			if (!fileop::writeFile(*f, "", 0)) return {};
+		}
+		videos.push_back(files[0]);
+	}
+	return videos;
+}
+
+void bench::subtitles(context& ctx) {
+	if (!want(ctx, "subresolver/")) return;
+	const size_t episodes = 50;
+	auto suffix = "/" + std::to_string(episodes);
+	auto dir = fileop::combilePath(ctx.tmpdir, "season");
+	auto videos = createSeasonDirectory(dir, episodes);
+	if (videos.empty()) {
+		note(ctx, "subresolver", "skipped: can not create season directory");
+		return;
+	}
+	config conf;
+	conf.subtitleLanguages = { "zh", "en" };
+	run(ctx, "subresolver/build" + suffix, [&]() {
+		subresolver r;
+		r.build(dir);
+	});
+	subresolver index;
+	index.build(dir);
+	std::vector<subresolver::candidate> ranked;
+	/* One index for the season, all episodes resolved. */
+	run(ctx, "subresolver/resolve-all" + suffix, [&]() {
+		for (auto i = videos.begin(); i != videos.end(); ++i) index.resolve(*i, &conf, ranked);
+	});
+	/* What starter does for one video: relative files and subdirectories, then ranking. */
+	run(ctx, "subresolver/per-video" + suffix, [&]() {
+		filelist fl;
+		subresolver r;
+		fileop::listrelative(videos[0], fl, false);
+		r.add(fl);
+		r.addSubdirectories(dir);
+		r.resolve(videos[0], &conf, ranked);
+	});
+	removeTree(dir);
+}
@@ -0,0 +1,163 @@
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include "bench.h"
+#include <stdlib.h>
+#include <string>
+#include "cml.h"
+#include "configfile.h"
+#include "starter.h"
+#include "util.h"
+#include "chariconv.h"
+#include "fileop.h"
+#include "subcharset.h"
+#ifdef HAVE_CHARDET
+#include "chardet.h"
+#endif
+
+/**
+ * @brief Generate an ASS subtitle with CJK dialogue
+ * @param lines The count of dialogue lines
+ * @return UTF-8 content
+*/
+std::string createSubtitle(size_t lines) {
+	std::string s = "[Script Info]\nScriptType: v4.00+\nPlayResX: 1920\nPlayResY: 1080\n\n[V4+ Styles]\n\
+Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n\
+Style: Default,\xE6\x80\x9D\xE6\xBA\x90\xE9\xBB\x91\xE4\xBD\x93,72,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,100,100,0,0,1,2,1,2,10,10,30,1\n\n[Events]\n\
+Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+	const char* texts[] = { "\xE4\xBB\x8A\xE5\xA4\xA9\xE7\x9A\x84\xE5\xA4\xA9\xE6\xB0\x94\xE7\x9C\x9F\xE5\xA5\xBD\xE3\x80\x82", "\xE6\x88\x91\xE4\xBB\xAC\xE8\xB5\xB0\xE5\x90\xA7\xEF\xBC\x81", "{\\fn\xE6\xA5\xB7\xE4\xBD\x93}\xE5\x86\x8D\xE8\xA7\x81\xE4\xBA\x86\xEF\xBC\x8C\xE6\x9C\x8B\xE5\x8F\x8B\xE3\x80\x82" };
+	char buf[64];
+	for (size_t i = 0; i < lines; i++) {
+		snprintf(buf, sizeof(buf), "0:%02zu:%02zu.00", i / 60 % 60, i % 60);
+		s += "Dialogue: 0,";
+		s += buf;
+		s += ",";
+		s += buf;
+		s += ",Default,,0,0,0,,";
+		s += texts[i % 3];
+		s += "\n";
+	}
+	return s;
+}
+
+void bench::text(context& ctx) {
+	const char* fake[] = { "ffplay-starter-bench", "video.mkv" };
+	cml cm(2, (char**)fake);
+	config conf;
+	starter st(cm, conf);
+	std::string sub = "/mnt/media/anime/[Group] Some Show S01/[Group] Some Show - 01 [1080p][HEVC].sc.ass";
+	std::string plain = "/mnt/media/anime/Some Show S01/Some Show - 01.sc.ass";
+	run(ctx, "starter::escape/brackets", [&]() {
+		st.escape(sub);
+	});
+	run(ctx, "starter::escape/plain", [&]() {
+		st.escape(plain);
+	});
+	/* Paths with a quote, with and without characters which need quoting in filtergraph. */
+	const char* quoted[][2] = {
+		{ "/mnt/media/it's a [test].ass", R"('/mnt/media/it\'\''s a [test].ass')" },
+		{ "C:\\Videos\\it's.ass", R"(C\\:\\\\Videos\\\\it\\\'s.ass)" },
+	};
+	for (int i = 0; i < 2; i++) {
+		if (st.escape(quoted[i][0]) != quoted[i][1]) note(ctx, "starter::escape/quote", ("failed: wrong result for " + std::string(quoted[i][0])).c_str());
+	}
+	run(ctx, "starter::escape/quote", [&]() {
+		st.escape(quoted[0][0]);
+	});
+	run(ctx, "util::strreplace", [&]() {
+		std::string s = "C:\\Users\\user\\Videos\\Some Show S01\\Some Show - 01.mkv";
+		util::strreplace(s, "\\", "/");
+	});
+	auto subtitle = createSubtitle(4000);
+	std::string config = "{\n\t\"ffplay\": [\"D:\\\\\xE8\xBD\xAF\xE4\xBB\xB6\\\\ffmpeg\\\\bin\\\\ffplay.exe\", \"ffplay\"],\n\t\"width\": 1280,\n\t\"autoExit\": true\n}\n";
+	char* out;
+	size_t outlen;
+	std::string gbk_subtitle, gbk_config;
+	if (chariconv::convert(subtitle.c_str(), subtitle.length(), out, outlen, "UTF-8", "GBK")) {
+		gbk_subtitle.assign(out, outlen);
+		free(out);
+	}
+	if (chariconv::convert(config.c_str(), config.length(), out, outlen, "UTF-8", "GBK")) {
+		gbk_config.assign(out, outlen);
+		free(out);
+	}
+#ifdef HAVE_CHARDET
+	const std::string* dets[] = { &subtitle, &gbk_subtitle, &config, &gbk_config };
+	const char* detnames[] = { "chardet::det/subtitle-utf8", "chardet::det/subtitle-gbk", "chardet::det/config-utf8", "chardet::det/config-gbk" };
+	for (int i = 0; i < 4; i++) {
+		if (dets[i]->empty()) continue;
+		run(ctx, detnames[i], [&]() {
+			char* encoding = nullptr;
+			short bom;
+			if (chardet::det(dets[i]->c_str(), dets[i]->length(), encoding, nullptr, bom)) free(encoding);
+		});
+	}
+#else
+	note(ctx, "chardet::det", "skipped: built without libchardet");
+#endif
+	if (gbk_subtitle.empty() || gbk_config.empty()) {
+		note(ctx, "chariconv::convert", "skipped: can not convert to GBK");
+		return;
+	}
+	run(ctx, "chariconv::convert/subtitle-gbk", [&]() {
+		if (chariconv::convert(gbk_subtitle.c_str(), gbk_subtitle.length(), out, outlen, "GBK", "UTF-8")) free(out);
+	});
+	run(ctx, "chariconv::convert/config-gbk", [&]() {
+		if (chariconv::convert(gbk_config.c_str(), gbk_config.length(), out, outlen, "GBK", "UTF-8")) free(out);
+	});
+	charsets(ctx);
+}
+
+void bench::charsets(context& ctx) {
+	if (!want(ctx, "subcharset/")) return;
+	/* A subtitle of a long film with many lines, about 16 MiB. */
+	auto subtitle = createSubtitle(200000);
+	auto utf8 = fileop::combilePath(ctx.tmpdir, "big.utf8.ass");
+	auto utf16 = fileop::combilePath(ctx.tmpdir, "big.utf16.ass");
+	auto gbk = fileop::combilePath(ctx.tmpdir, "big.gbk.ass");
+	char* out;
+	size_t outlen;
+	if (!fileop::writeFile(utf8, subtitle.c_str(), subtitle.length())) {
+		note(ctx, "subcharset", "skipped: can not write subtitles");
+		return;
+	}
+	std::string encoding;
+	/* The cost of checking the whole file, which the bounded sample avoids. */
+	run(ctx, "subcharset/whole-file/utf8", [&]() {
+		std::string data;
+		fileop::readFile(utf8, data, 64 * 1024 * 1024);
+		subcharset::isUTF8(data);
+	});
+	run(ctx, "subcharset/detect/utf8", [&]() {
+		subcharset::detect(utf8, encoding);
+	});
+	if (chariconv::convert(subtitle.c_str(), subtitle.length(), out, outlen, "UTF-8", "GBK")) {
+		fileop::writeFile(gbk, out, outlen);
+		free(out);
+#ifdef HAVE_CHARDET
+		run(ctx, "subcharset/detect/gbk", [&]() {
+			subcharset::detect(gbk, encoding);
+		});
+#else
+		note(ctx, "subcharset/detect/gbk", "skipped: built without libchardet");
+#endif
+	}
+	if (!chariconv::convert(subtitle.c_str(), subtitle.length(), out, outlen, "UTF-8", "UTF-16LE")) {
+		note(ctx, "subcharset/prepare", "skipped: can not convert to UTF-16");
+		return;
+	}
+	std::string data = "\xFF\xFE";
+	data.append(out, outlen);
+	free(out);
+	fileop::writeFile(utf16, data.c_str(), data.length());
+	/* The first run converts, later ones find the cached copy. */
+	run(ctx, "subcharset/prepare-cached/utf16", [&]() {
+		std::string path = utf16, charenc;
+		subcharset::prepare(path, charenc);
+	});
+	/* UTF-8 is not cached, every run checks the sample. */
+	run(ctx, "subcharset/prepare/utf8", [&]() {
+		std::string path = utf8, charenc;
+		subcharset::prepare(path, charenc);
+	});
+}
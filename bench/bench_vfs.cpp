@@ -0,0 +1,105 @@
+#include "bench.h"
+#include <stdio.h>
+#include <list>
+#include <string>
+#include "dirindex.h"
+#include "dirscan.h"
+#include "fileop.h"
+#include "memfs.h"
+
+/**
+ * @brief The std::list based filter used before filelist, kept as the baseline
+*/
+bool filterListByExt(std::list<std::string> fl, std::list<std::string> exts, std::list<std::string>& result) {
+	if (fl.empty() || exts.empty()) return false;
+	result.clear();
+	for (auto i = fl.begin(); i != fl.end(); ++i) {
+		auto fn = *i;
+		std::string ext;
+		if (!fileop::splitext(fn, nullptr, &ext)) return false;
+		for (auto j = exts.begin(); j != exts.end(); ++j) {
+			if ("." + *j == ext) {
+				result.push_back(fn);
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Fill a directory of memfs like bench::createEpisodeDirectory does
+ * @return the path of a video in the middle of the directory
+*/
+std::string createVirtualDirectory(memfs& fs, const std::string& dir, size_t entries) {
+	const char* exts[] = { ".mkv", ".ass", ".sc.ass", ".tc.ass", ".srt" };
+	char name[128];
+	for (size_t i = 0; i < entries; i++) {
+		snprintf(name, sizeof(name), "[Group] Some Show - %06zu [1080p][HEVC]%s", i / 5, exts[i % 5]);
+		fs.add(dir + name);
+	}
+	snprintf(name, sizeof(name), "[Group] Some Show - %06zu [1080p][HEVC].mkv", entries / 10);
+	return dir + name;
+}
+
+void bench::vfs(context& ctx) {
+	memfs fs;
+	fileop::setBackend(&fs);
+	for (size_t entries = 10; entries <= ctx.vfs_entries; entries *= 10) {
+		auto suffix = "/" + std::to_string(entries);
+		auto dir = "/vfs/dir" + std::to_string(entries) + "/";
+		auto target = createVirtualDirectory(fs, dir, entries);
+		run(ctx, "vfs/dirscan::scan" + suffix, [&]() {
+			dirscan scanner;
+			scanner.scan(dir);
+		});
+		run(ctx, "vfs/listrelative" + suffix, [&]() {
+			filelist fl;
+			fileop::listrelative(target, fl, false);
+		});
+		filelist all;
+		fileop::listdir(dir, all);
+		run(ctx, "vfs/filterFileListByExt" + suffix, [&]() {
+			filelist result;
+			fileop::filterFileListByExt(all, { "ass" }, result);
+		});
+		if (want(ctx, "vfs/filterFileListByExt-stdlist" + suffix)) {
+			std::list<std::string> copy;
+			for (auto i = all.begin(); i != all.end(); ++i) copy.push_back(std::string(*i));
+			run(ctx, "vfs/filterFileListByExt-stdlist" + suffix, [&]() {
+				std::list<std::string> result;
+				filterListByExt(copy, { "ass" }, result);
+			});
+		}
+		dirscan scanner;
+		fileop::fileid id;
+		if (want(ctx, "vfs/listrelative-index" + suffix) && scanner.scan(dir) && fileop::getFileId(dir, id) && dirindex::store(scanner, id)) {
+			run(ctx, "vfs/listrelative-index" + suffix, [&]() {
+				filelist fl;
+				fileop::listrelative(target, fl);
+			});
+		}
+	}
+	/* A remote directory: every call is a round trip, every 512 entries is another one. */
+	size_t slow = ctx.vfs_entries < 10000 ? ctx.vfs_entries : 10000;
+	if (slow >= 10 && want(ctx, "vfs/slow/")) {
+		auto dir = "/vfs/slow/";
+		auto target = createVirtualDirectory(fs, dir, slow);
+		fs.setLatency(200, 200);
+		auto suffix = "/" + std::to_string(slow);
+		run(ctx, "vfs/slow/listrelative" + suffix, [&]() {
+			filelist fl;
+			fileop::listrelative(target, fl, false);
+		});
+		dirscan scanner;
+		fileop::fileid id;
+		if (scanner.scan(dir) && fileop::getFileId(dir, id) && dirindex::store(scanner, id)) {
+			run(ctx, "vfs/slow/listrelative-index" + suffix, [&]() {
+				filelist fl;
+				fileop::listrelative(target, fl);
+			});
+		}
+		fs.setLatency(0, 0);
+	}
+	fileop::setBackend(nullptr);
+}
@@ -0,0 +1,110 @@
+/* A stand-in ffplay for startup benchmarks. It answers capability queries like a
+ * real build with libass, records its arguments and exits without opening a window.
+ *
+ * Environment variables:
+ * FAKE_FFPLAY_LOG          Append a line to this file for every invocation:
+ *                          monotonic start time in nanoseconds followed by arguments, separated by tab.
+ * FAKE_FFPLAY_DELAY        Milliseconds to wait before exiting when playing.
+ * FAKE_FFPLAY_PROBE_DELAY  Milliseconds to wait before answering a query.
+ * FAKE_FFPLAY_EXIT         Exit code when playing. (Default: 0)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+static const char* version = "ffplay version 6.1-fake Copyright (c) 2003-2023 the FFmpeg developers\n";
+static const char* filters = "Filters:\n\
+  T.. = Timeline support\n\
+  .S. = Slice threading\n\
+  ..C = Command support\n\
+  A = Audio input/output\n\
+  V = Video input/output\n\
+  N = Dynamic number and/or type of input/output\n\
+  | = Source or sink filter\n\
+ ... ass               V->V       Render ASS subtitles onto input video using the libass library.\n\
+ TSC scale             V->V       Scale the input video size and/or convert the image format.\n\
+ ... subtitles         V->V       Render text subtitles onto input video using the libass library.\n";
+static const char* protocols = "Supported file protocols:\n\
+Input:\n\
+  async\n\
+  cache\n\
+  file\n\
+  http\n\
+  pipe\n\
+Output:\n\
+  file\n\
+  pipe\n";
+static const char* decoders = "Decoders:\n\
+ V..... = Video\n\
+ A..... = Audio\n\
+ S..... = Subtitle\n\
+ ------\n\
+ V....D h264                 H.264 / AVC / MPEG-4 AVC / MPEG-4 part 10\n\
+ V....D hevc                 HEVC (High Efficiency Video Coding)\n\
+ A....D aac                  AAC (Advanced Audio Coding)\n\
+ S..... ssa                  ASS (Advanced SubStation Alpha) subtitle (codec ass)\n\
+ S..... ass                  ASS (Advanced SubStation Alpha) subtitle\n\
+ S..... pgssub               HDMV Presentation Graphic Stream subtitles\n\
+ S..... subrip               SubRip subtitle\n\
+ S..... webvtt               WebVTT subtitle\n";
+static const char* buildconf = "  configuration:\n\
+    --prefix=/usr\n\
+    --enable-gpl\n\
+    --enable-libass\n\
+    --enable-libfontconfig\n\
+    --enable-libfreetype\n\
+    --enable-sdl2\n";
+
+/**
+ * @brief Get a non-negative integer from environment variable
+ * @param name The name of variable
+ * @param def Default value
+ * @return the value
+*/
+int getEnvInt(const char* name, int def) {
+	auto v = getenv(name);
+	if (!v || !*v) return def;
+	return atoi(v);
+}
+
+void sleepMs(int ms) {
+	if (ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void writeLog(uint64_t start, int argc, char* argv[]) {
+	auto path = getenv("FAKE_FFPLAY_LOG");
+	if (!path || !*path) return;
+	auto f = fopen(path, "a");
+	if (!f) return;
+	fprintf(f, "%llu", (unsigned long long)start);
+	for (int i = 1; i < argc; i++) fprintf(f, "\t%s", argv[i]);
+	fputc('\n', f);
+	fclose(f);
+}
+
+int main(int argc, char* argv[]) {
+	auto start = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	writeLog(start, argc, argv);
+	bool banner = true;
+	const char* answer = nullptr;
+	for (int i = 1; i < argc; i++) {
+		auto a = argv[i];
+		if (!strcmp(a, "-hide_banner")) banner = false;
+		else if (!strcmp(a, "-version")) answer = "";
+		else if (!strcmp(a, "-h") || !strcmp(a, "-help") || !strcmp(a, "--help")) answer = "usage: ffplay [options] input_file\n";
+		else if (!strcmp(a, "-filters")) answer = filters;
+		else if (!strcmp(a, "-protocols")) answer = protocols;
+		else if (!strcmp(a, "-decoders")) answer = decoders;
+		else if (!strcmp(a, "-buildconf")) answer = buildconf;
+	}
+	if (answer) {
+		sleepMs(getEnvInt("FAKE_FFPLAY_PROBE_DELAY", 0));
+		if (banner || !*answer) fputs(version, stdout);
+		fputs(answer, stdout);
+		return 0;
+	}
+	sleepMs(getEnvInt("FAKE_FFPLAY_DELAY", 0));
+	return getEnvInt("FAKE_FFPLAY_EXIT", 0);
+}
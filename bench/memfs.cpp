@@ -0,0 +1,224 @@
+#include "memfs.h"
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+memfs::memfs() {
+	/* Look like a directory in a media library: modified long ago. */
+	clock = ((long long)time(nullptr) - 3600) * 1000000000LL;
+	dirs["/"].ino = inode++;
+}
+
+void memfs::setLatency(int op, int batch, size_t batchEntries) {
+	std::lock_guard<std::mutex> lock(mutex);
+	oplatency = op;
+	batchlatency = batch;
+	batchentries = batchEntries ? batchEntries : 1;
+}
+
+long long memfs::tick() {
+	return ++clock;
+}
+
+void memfs::wait(int us) {
+	if (us > 0) std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+bool memfs::splitPath(std::string path, std::string& dir, std::string& name) {
+	std::replace(path.begin(), path.end(), '\\', '/');
+	while (path.length() > 1 && path.back() == '/') path.pop_back();
+	auto p = path.rfind('/');
+	if (p == std::string::npos || p + 1 >= path.length()) return false;
+	dir = path.substr(0, p + 1);
+	name = path.substr(p + 1);
+	return true;
+}
+
+memfs::directory* memfs::getDirectory(const std::string& path, bool create) {
+	auto d = path;
+	std::replace(d.begin(), d.end(), '\\', '/');
+	if (d.empty() || d.back() != '/') d += '/';
+	auto i = dirs.find(d);
+	if (i != dirs.end()) return &i->second;
+	if (!create) return nullptr;
+	std::string parent, name;
+	if (!splitPath(d, parent, name)) return nullptr;
+	auto p = getDirectory(parent, true);
+	if (!p) return nullptr;
+	addNode(*p, name, dirscan::DIRECTORY);
+	auto& nd = dirs[d];
+	nd.ino = inode++;
+	nd.mtime = tick();
+	return &nd;
+}
+
+memfs::node* memfs::findNode(directory& d, std::string_view name) {
+	if (d.dirty || d.sorted.size() != d.nodes.size()) {
+		d.sorted.resize(d.nodes.size());
+		for (uint32_t i = 0; i < d.nodes.size(); i++) d.sorted[i] = i;
+		auto names = d.names.data();
+		auto& nodes = d.nodes;
+		std::sort(d.sorted.begin(), d.sorted.end(), [names, &nodes](uint32_t a, uint32_t b) {
+			return std::string_view(names + nodes[a].name, nodes[a].len) < std::string_view(names + nodes[b].name, nodes[b].len);
+		});
+		d.dirty = false;
+	}
+	auto names = d.names.data();
+	auto& nodes = d.nodes;
+	auto i = std::lower_bound(d.sorted.begin(), d.sorted.end(), name, [names, &nodes](uint32_t a, std::string_view n) {
+		return std::string_view(names + nodes[a].name, nodes[a].len) < n;
+	});
+	if (i == d.sorted.end() || std::string_view(names + nodes[*i].name, nodes[*i].len) != name) return nullptr;
+	return &nodes[*i];
+}
+
+memfs::node& memfs::addNode(directory& d, std::string_view name, dirscan::entry_type type) {
+	node n;
+	n.name = (uint32_t)d.names.length();
+	n.len = (uint32_t)name.length();
+	n.type = type;
+	n.ino = inode++;
+	n.mtime = tick();
+	d.names.append(name.data(), name.length());
+	d.names.push_back(0);
+	d.nodes.push_back(n);
+	d.dirty = true;
+	d.mtime = n.mtime;
+	return d.nodes.back();
+}
+
+bool memfs::add(const std::string& path, std::string data) {
+	std::string dir, name;
+	if (!splitPath(path, dir, name)) return false;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto d = getDirectory(dir, true);
+	if (!d) return false;
+	auto& n = addNode(*d, name, dirscan::FILE);
+	if (!data.empty()) {
+		n.content = (int64_t)contents.size();
+		contents.push_back(std::move(data));
+	}
+	return true;
+}
+
+size_t memfs::size() {
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t re = 0;
+	for (auto i = dirs.begin(); i != dirs.end(); ++i) re += i->second.nodes.size();
+	return re;
+}
+
+bool memfs::listdir(const std::string& dir, std::string_view prefix, dirscan& out) {
+	wait(oplatency);
+	std::unique_lock<std::mutex> lock(mutex);
+	auto d = getDirectory(dir, false);
+	if (!d) return false;
+	auto names = d->names.data();
+	size_t count = d->nodes.size();
+	for (size_t i = 0; i < count; i++) {
+		if (batchlatency > 0 && i && !(i % batchentries)) {
+			lock.unlock();
+			wait(batchlatency);
+			lock.lock();
+			names = d->names.data();
+			count = d->nodes.size();
+			if (i >= count) break;
+		}
+		auto& n = d->nodes[i];
+		if (!n.len || names[n.name] == '.') continue;
+		if (std::string_view(names + n.name, n.len).compare(0, prefix.length(), prefix)) {
+			out.skip();
+			continue;
+		}
+		out.add(names + n.name, n.len, n.type);
+	}
+	return true;
+}
+
+bool memfs::stat(const std::string& path, fileop::fileid& id) {
+	wait(oplatency);
+	std::lock_guard<std::mutex> lock(mutex);
+	auto d = getDirectory(path, false);
+	if (d) {
+		id.dev = 1;
+		id.ino = d->ino;
+		id.size = d->nodes.size();
+		id.mtime = id.ctime = d->mtime;
+		return true;
+	}
+	std::string dir, name;
+	if (!splitPath(path, dir, name) || !(d = getDirectory(dir, false))) return false;
+	auto n = findNode(*d, name);
+	if (!n) return false;
+	id.dev = 1;
+	id.ino = n->ino;
+	id.size = n->content >= 0 ? contents[n->content].size() : 0;
+	id.mtime = id.ctime = n->mtime;
+	return true;
+}
+
+bool memfs::exists(const std::string& path) {
+	fileop::fileid id;
+	return stat(path, id);
+}
+
+bool memfs::readFile(const std::string& path, std::string& data, size_t maxSize) {
+	wait(oplatency);
+	std::lock_guard<std::mutex> lock(mutex);
+	std::string dir, name;
+	directory* d;
+	if (!splitPath(path, dir, name) || !(d = getDirectory(dir, false))) return false;
+	auto n = findNode(*d, name);
+	if (!n || n->type != dirscan::FILE) return false;
+	if (n->content < 0) {
+		data.clear();
+		return true;
+	}
+	if (contents[n->content].size() > maxSize) return false;
+	data = contents[n->content];
+	return true;
+}
+
+bool memfs::writeFile(const std::string& path, const char* data, size_t len) {
+	wait(oplatency);
+	std::lock_guard<std::mutex> lock(mutex);
+	std::string dir, name;
+	directory* d;
+	if (!splitPath(path, dir, name) || !(d = getDirectory(dir, false))) return false;
+	auto n = findNode(*d, name);
+	if (n && n->type != dirscan::FILE) return false;
+	if (!n) n = &addNode(*d, name, dirscan::FILE);
+	if (n->content < 0) {
+		n->content = (int64_t)contents.size();
+		contents.emplace_back();
+	}
+	contents[n->content].assign(data, len);
+	n->mtime = d->mtime = tick();
+	return true;
+}
+
+bool memfs::mkdir(const std::string& path) {
+	wait(oplatency);
+	std::lock_guard<std::mutex> lock(mutex);
+	if (getDirectory(path, false)) return true;
+	std::string parent, name;
+	if (!splitPath(path, parent, name) || !getDirectory(parent, false)) return false;
+	return getDirectory(path, true) != nullptr;
+}
+
+bool memfs::touch(const std::string& path) {
+	wait(oplatency);
+	std::lock_guard<std::mutex> lock(mutex);
+	auto d = getDirectory(path, false);
+	if (d) {
+		d->mtime = tick();
+		return true;
+	}
+	std::string dir, name;
+	if (!splitPath(path, dir, name) || !(d = getDirectory(dir, false))) return false;
+	auto n = findNode(*d, name);
+	if (!n) return false;
+	n->mtime = tick();
+	return true;
+}
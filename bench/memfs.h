@@ -0,0 +1,85 @@
+#ifndef _ST_MEMFS_H
+#define _ST_MEMFS_H
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "dirscan.h"
+#include "fsbackend.h"
+
+/**
+ * @brief In-memory file system backend for benchmarks.
+ * Paths use `/` as separator. Every directory keeps names in one buffer, so millions of entries are cheap.
+ * Latency can be injected to simulate slow file systems.
+*/
+class memfs : public fsbackend {
+public:
+	memfs();
+	/**
+	 * @brief Set injected latency
+	 * @param op Microseconds waited by every operation
+	 * @param batch Microseconds waited for every batch of entries when listing a directory
+	 * @param batchEntries The count of entries in a batch, like the entries returned by one getdents call
+	*/
+	void setLatency(int op, int batch, size_t batchEntries = 512);
+	/**
+	 * @brief Add a file quickly without checking whether it already exists. Parent directories are created.
+	 * @param path The path
+	 * @param data File content
+	 * @return true if OK
+	*/
+	bool add(const std::string& path, std::string data = std::string());
+	/**
+	 * @brief Get the count of all entries
+	*/
+	size_t size();
+	bool listdir(const std::string& dir, std::string_view prefix, dirscan& out) override;
+	bool stat(const std::string& path, fileop::fileid& id) override;
+	bool exists(const std::string& path) override;
+	bool readFile(const std::string& path, std::string& data, size_t maxSize) override;
+	bool writeFile(const std::string& path, const char* data, size_t len) override;
+	bool mkdir(const std::string& path) override;
+	bool touch(const std::string& path) override;
+private:
+	typedef struct node {
+		uint32_t name = 0;
+		uint32_t len = 0;
+		dirscan::entry_type type = dirscan::FILE;
+		/// Index in contents, -1 if empty
+		int64_t content = -1;
+		uint64_t ino = 0;
+		long long mtime = 0;
+	} node;
+	typedef struct directory {
+		std::string names;
+		std::vector<node> nodes;
+		/// Node indexes sorted by name, rebuilt when needed
+		std::vector<uint32_t> sorted;
+		bool dirty = false;
+		uint64_t ino = 0;
+		long long mtime = 0;
+	} directory;
+	/// Directories by path ends with `/`
+	std::unordered_map<std::string, directory> dirs;
+	std::vector<std::string> contents;
+	std::mutex mutex;
+	uint64_t inode = 1;
+	long long clock = 0;
+	int oplatency = 0;
+	int batchlatency = 0;
+	size_t batchentries = 512;
+	long long tick();
+	void wait(int us);
+	directory* getDirectory(const std::string& path, bool create);
+	node* findNode(directory& d, std::string_view name);
+	node& addNode(directory& d, std::string_view name, dirscan::entry_type type);
+	/**
+	 * @brief Split normalized path to directory (ends with `/`) and name
+	*/
+	static bool splitPath(std::string path, std::string& dir, std::string& name);
+};
+
+#endif
@@ -0,0 +1,88 @@
+#[=======================================================================[.rst:
+FindFontconfig
+-------
+
+Finds the Fontconfig library.
+
+Imported Targets
+^^^^^^^^^^^^^^^^
+
+This module provides the following imported targets, if found:
+
+``Fontconfig::Fontconfig``
+  The Fontconfig library
+
+Result Variables
+^^^^^^^^^^^^^^^^
+
+This will define the following variables:
+
+``Fontconfig_FOUND``
+  True if the system has the Fontconfig library.
+``Fontconfig_VERSION``
+  The version of the Fontconfig library which was found.
+``Fontconfig_INCLUDE_DIRS``
+  Include directories needed to use Fontconfig.
+``Fontconfig_LIBRARIES``
+  Libraries needed to link to Fontconfig.
+
+Cache Variables
+^^^^^^^^^^^^^^^
+
+The following cache variables may also be set:
+
+``Fontconfig_INCLUDE_DIR``
+  The directory containing ``fontconfig/fontconfig.h``.
+``Fontconfig_LIBRARY``
+  The path to the Fontconfig library.
+
+#]=======================================================================]
+find_package(PkgConfig)
+if (PkgConfig_FOUND)
+    pkg_check_modules(PC_Fontconfig QUIET fontconfig)
+endif()
+
+find_path(Fontconfig_INCLUDE_DIR NAMES "fontconfig/fontconfig.h" PATHS ${PC_Fontconfig_INCLUDE_DIRS})
+find_library(Fontconfig_LIBRARY NAMES fontconfig libfontconfig PATHS ${PC_Fontconfig_LIBRARY_DIRS})
+if (PC_Fontconfig_FOUND)
+    set(Fontconfig_VERSION ${PC_Fontconfig_VERSION})
+    set(Fontconfig_VERSION_STRING ${Fontconfig_VERSION})
+endif()
+if (NOT Fontconfig_VERSION AND EXISTS "${Fontconfig_INCLUDE_DIR}/fontconfig/fontconfig.h")
+    file(STRINGS "${Fontconfig_INCLUDE_DIR}/fontconfig/fontconfig.h" TEMPFontconfig_VERSION
+    REGEX "^#[\t ]*define[\t ]+FC_(MAJOR|MINOR|REVISION)[\t ]+[0-9]+$")
+    set(TEMPFontconfig_PARTS)
+    foreach(TEMPFontconfig_LINE ${TEMPFontconfig_VERSION})
+        string(REGEX MATCH "[0-9]+$" TEMPFontconfig_PART ${TEMPFontconfig_LINE})
+        list(APPEND TEMPFontconfig_PARTS ${TEMPFontconfig_PART})
+    endforeach()
+    if (NOT "${TEMPFontconfig_PARTS}" STREQUAL "")
+        string(REPLACE ";" "." Fontconfig_VERSION "${TEMPFontconfig_PARTS}")
+        set(Fontconfig_VERSION_STRING ${Fontconfig_VERSION})
+    endif()
+endif()
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Fontconfig
+    FOUND_VAR Fontconfig_FOUND
+    REQUIRED_VARS
+        Fontconfig_LIBRARY
+        Fontconfig_INCLUDE_DIR
+    VERSION_VAR Fontconfig_VERSION
+)
+
+if (Fontconfig_FOUND)
+    set(Fontconfig_LIBRARIES ${Fontconfig_LIBRARY})
+    set(Fontconfig_INCLUDE_DIRS ${Fontconfig_INCLUDE_DIR})
+    if (PC_Fontconfig_FOUND)
+        set(Fontconfig_DEFINITIONS ${PC_Fontconfig_CFLAGS_OTHER})
+    endif()
+    if (NOT TARGET Fontconfig::Fontconfig)
+        add_library(Fontconfig::Fontconfig UNKNOWN IMPORTED)
+        set_target_properties(Fontconfig::Fontconfig PROPERTIES
+            IMPORTED_LOCATION "${Fontconfig_LIBRARY}"
+            INTERFACE_COMPILE_OPTIONS "${PC_Fontconfig_CFLAGS_OTHER}"
+            INTERFACE_INCLUDE_DIRECTORIES "${Fontconfig_INCLUDE_DIR}"
+        )
+    endif()
+endif()
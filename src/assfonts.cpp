@@ -0,0 +1,631 @@
+#include "assfonts.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#ifdef HAVE_FONTCONFIG
+#include <fontconfig/fontconfig.h>
+#endif
+#include "console.h"
+#include "fileop.h"
+#include "pathview.h"
+#include "trace.h"
+#include "util.h"
+
+#define FONTS_CONFIG_NAME "fonts.conf"
+#define FONTS_LIST_NAME "fonts.list"
+#define SUBTITLES_LIST_NAME "subtitles.list"
+/// Links to system fonts, the only font directory in the fontconfig config
+#define SYSTEM_FONTS_DIR "system"
+/// Links to extracted embedded fonts, passed as fontsdir
+#define EMBEDDED_FONTS_DIR "embedded"
+/// The max count of fallback fonts added to cover text
+#define MAX_FALLBACK_FONTS 8
+/// The size of chunks a script is read in
+#define SCAN_CHUNK_SIZE (64 * 1024)
+
+static std::string_view trim(std::string_view s) {
+	while (!s.empty() && isspace((unsigned char)s.front())) s.remove_prefix(1);
+	while (!s.empty() && isspace((unsigned char)s.back())) s.remove_suffix(1);
+	return s;
+}
+
+/**
+ * @brief Get the field of a comma separated line, the last field contains all remaining commas
+*/
+static std::string_view getField(std::string_view values, size_t index, bool last = false) {
+	for (size_t i = 0; i < index; i++) {
+		auto comma = values.find(',');
+		if (comma == std::string_view::npos) return std::string_view();
+		values.remove_prefix(comma + 1);
+	}
+	if (last) return values;
+	return trim(values.substr(0, values.find(',')));
+}
+
+/**
+ * @brief Get the index of a field from a Format line
+*/
+static size_t getFieldIndex(std::string_view format, std::string_view name, size_t def) {
+	size_t index = 0;
+	while (true) {
+		auto comma = format.find(',');
+		if (util::equalsIgnoreCase(trim(format.substr(0, comma)), name)) return index;
+		if (comma == std::string_view::npos) return def;
+		format.remove_prefix(comma + 1);
+		index++;
+	}
+}
+
+static void addFamily(std::string_view name, std::list<std::string>& families) {
+	name = trim(name);
+	if (!name.empty() && name.front() == '@') name.remove_prefix(1);
+	if (name.empty()) return;
+	for (auto i = families.begin(); i != families.end(); ++i) {
+		if (util::equalsIgnoreCase(*i, name)) return;
+	}
+	families.push_back(std::string(name));
+}
+
+/**
+ * @brief Collect \fn overrides and shown characters of the text of an event
+*/
+static void parseEventText(std::string_view s, std::list<std::string>& families, std::string* text) {
+	size_t i = 0;
+	while (i < s.length()) {
+		if (s[i] == '{') {
+			auto end = s.find('}', i);
+			if (end == std::string_view::npos) end = s.length();
+			auto block = s.substr(i + 1, end - i - 1);
+			size_t p = 0;
+			while ((p = block.find("\\fn", p)) != std::string_view::npos) {
+				p += 3;
+				auto e = block.find('\\', p);
+				addFamily(block.substr(p, e == std::string_view::npos ? e : e - p), families);
+			}
+			i = end + 1;
+		} else if (s[i] == '\\' && i + 1 < s.length() && (s[i + 1] == 'N' || s[i + 1] == 'n' || s[i + 1] == 'h')) {
+			i += 2;
+		} else {
+			if (text) *text += s[i];
+			i++;
+		}
+	}
+}
+
+/**
+ * @brief Check whether a line in [Fonts] is a section header.
+ * Encoded data only uses characters from `!` to `` ` ``, and can start with `[`,
+ * but every section name contains a space or a lower case letter.
+*/
+static bool isFontsSectionEnd(std::string_view line) {
+	if (line.front() != '[' || line.back() != ']') return false;
+	for (auto c : line) {
+		if (c == ' ' || (unsigned char)c > '`') return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Parse an ASS script line by line, so a big script can be read in chunks
+*/
+class scriptparser {
+public:
+	scriptparser(std::list<std::string>& families, std::string* text): families(families), text(text) {}
+	/**
+	 * @brief Parse a line
+	 * @return true if the line belongs to [Fonts]
+	*/
+	bool line(std::string_view line);
+	/**
+	 * @brief Finish the script, the last embedded font is finished too
+	*/
+	bool finish() {
+		finishFont();
+		return !failed;
+	}
+	/// Where to extract embedded fonts, empty to skip them
+	std::string fontsDir;
+	/// Extracted embedded fonts
+	std::list<std::string> fonts;
+	/// Whether the script has a [Fonts] section
+	bool hasFonts = false;
+private:
+	void finishFont();
+	bool failed = false;
+	std::list<std::string>& families;
+	std::string* text;
+	enum { OTHER, STYLES, EVENTS, FONTS } section = OTHER;
+	size_t fontIndex = 1, textIndex = 9;
+	std::string fontName;
+	std::string fontData;
+	std::string decoded;
+};
+
+bool scriptparser::line(std::string_view line) {
+	line = trim(line);
+	if (section == FONTS) {
+		if (line.empty()) return true;
+		if (!isFontsSectionEnd(line)) {
+			if (line.length() > 9 && util::equalsIgnoreCase(line.substr(0, 9), "fontname:")) {
+				finishFont();
+				fontName = trim(line.substr(9));
+			} else if (!fontName.empty() && !fontsDir.empty()) {
+				/* Lines are joined before decoding, a group of 4 characters can span two lines. */
+				fontData.append(line.data(), line.length());
+			}
+			return true;
+		}
+		finishFont();
+	}
+	if (line.empty() || line.front() == ';') return false;
+	if (line.front() == '[') {
+		if (util::equalsIgnoreCase(line, "[V4+ Styles]") || util::equalsIgnoreCase(line, "[V4 Styles]")) section = STYLES;
+		else if (util::equalsIgnoreCase(line, "[Events]")) section = EVENTS;
+		else if (util::equalsIgnoreCase(line, "[Fonts]")) section = FONTS;
+		else section = OTHER;
+		if (section == FONTS) hasFonts = true;
+		return section == FONTS;
+	}
+	if (section == OTHER) return false;
+	auto colon = line.find(':');
+	if (colon == std::string_view::npos) return false;
+	auto key = trim(line.substr(0, colon));
+	auto values = line.substr(colon + 1);
+	if (section == STYLES) {
+		if (util::equalsIgnoreCase(key, "Format")) fontIndex = getFieldIndex(values, "Fontname", 1);
+		else if (util::equalsIgnoreCase(key, "Style")) addFamily(getField(values, fontIndex), families);
+	} else {
+		if (util::equalsIgnoreCase(key, "Format")) textIndex = getFieldIndex(values, "Text", 9);
+		else if (util::equalsIgnoreCase(key, "Dialogue")) parseEventText(getField(values, textIndex, true), families, text);
+	}
+	return false;
+}
+
+void scriptparser::finishFont() {
+	if (fontName.empty() || fontData.empty()) {
+		fontName.clear();
+		fontData.clear();
+		return;
+	}
+	/* Named by the encoded data, so the same font embedded in every episode of a release is extracted once. */
+	uint64_t h = util::fnv1a(FNV1A_INIT, fontData.data(), fontData.length());
+	std::string name = fontName;
+	for (auto& c : name) {
+		if (pathview::isSeparator(c) || c == ':' || c == '*' || c == '?' || c == '"' || c == '<' || c == '>' || c == '|') c = '_';
+	}
+	char prefix[24];
+	snprintf(prefix, sizeof(prefix), "%016llx-", (unsigned long long)h);
+	auto path = fileop::combilePath(fontsDir, prefix + name);
+	bool ok = true;
+	/* Touched when reused, prepared directories of later episodes link it. */
+	if (!fileop::touch(path)) {
+		assfonts::uudecode(fontData, decoded);
+		ok = fileop::writeFile(path, decoded.data(), decoded.length());
+		if (ok) console::verbose("Extracted embedded font \"%s\": %s", fontName.c_str(), path.c_str());
+	}
+	if (ok) fonts.push_back(path);
+	else failed = true;
+	fontName.clear();
+	fontData.clear();
+}
+
+void assfonts::uudecode(std::string_view in, std::string& out) {
+	size_t groups = in.length() / 4, left = in.length() % 4;
+	out.resize(groups * 3 + (left ? left - 1 : 0));
+	auto s = (const unsigned char*)in.data();
+	auto d = (unsigned char*)&out[0];
+	size_t i = 0;
+#if (defined(_WIN32) && !defined(__CYGWIN__)) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	/* Two groups in a 64 bit word at once: remove the offset of all 8 characters, then merge 6 bit fields into 12 and 24 bit ones. */
+	for (; i + 2 <= groups; i += 2, s += 8, d += 6) {
+		uint64_t x;
+		memcpy(&x, s, 8);
+		x = (x - 0x2121212121212121ULL) & 0x3f3f3f3f3f3f3f3fULL;
+		x = (x & 0x00ff00ff00ff00ffULL) << 6 | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+		x = (x & 0x0000ffff0000ffffULL) << 12 | ((x >> 16) & 0x0000ffff0000ffffULL);
+		d[0] = (unsigned char)(x >> 16);
+		d[1] = (unsigned char)(x >> 8);
+		d[2] = (unsigned char)x;
+		d[3] = (unsigned char)(x >> 48);
+		d[4] = (unsigned char)(x >> 40);
+		d[5] = (unsigned char)(x >> 32);
+	}
+#endif
+	/* Every character carries 6 bits, offset by 33. */
+	for (; i < groups; i++, s += 4, d += 3) {
+		uint32_t v = ((uint32_t)(s[0] - 33) & 63) << 18 | ((uint32_t)(s[1] - 33) & 63) << 12 | ((uint32_t)(s[2] - 33) & 63) << 6 | ((uint32_t)(s[3] - 33) & 63);
+		d[0] = (unsigned char)(v >> 16);
+		d[1] = (unsigned char)(v >> 8);
+		d[2] = (unsigned char)v;
+	}
+	/* The last group of 2 or 3 characters holds 1 or 2 bytes. */
+	if (left > 1) {
+		uint32_t v = ((uint32_t)(s[0] - 33) & 63) << 18 | ((uint32_t)(s[1] - 33) & 63) << 12 | (left > 2 ? ((uint32_t)(s[2] - 33) & 63) << 6 : 0);
+		d[0] = (unsigned char)(v >> 16);
+		if (left > 2) d[1] = (unsigned char)(v >> 8);
+	}
+}
+
+void assfonts::getFamilies(std::string_view data, std::list<std::string>& families, std::string* text) {
+	scriptparser parser(families, text);
+	size_t start = 0;
+	while (start < data.length()) {
+		auto end = data.find('\n', start);
+		if (end == std::string_view::npos) end = data.length();
+		parser.line(data.substr(start, end - start));
+		start = end + 1;
+	}
+}
+
+bool assfonts::scan(const std::string& path, std::list<std::string>& families, std::string* text, std::list<std::string>& fonts, std::string* stripped) {
+	trace::scope t("assfonts::scan");
+	scriptparser parser(families, text);
+	auto cache = fileop::getCacheDir();
+	if (!cache.empty()) {
+		parser.fontsDir = fileop::combilePath(fileop::combilePath(cache, "fonts"), "embedded");
+		if (!fileop::mkdirs(parser.fontsDir)) parser.fontsDir.clear();
+	}
+	auto f = fileop::open(path.c_str(), "rb");
+	if (!f) return false;
+	std::string rest, copy;
+	std::vector<char> chunk(SCAN_CHUNK_SIZE);
+	auto feed = [&](std::string_view line) {
+		if (parser.line(line)) return;
+		copy.append(line.data(), line.length());
+		copy += '\n';
+	};
+	size_t n;
+	while ((n = fread(chunk.data(), 1, chunk.size(), f)) > 0) {
+		rest.append(chunk.data(), n);
+		size_t start = 0, end;
+		while ((end = rest.find('\n', start)) != std::string::npos) {
+			feed(std::string_view(rest).substr(start, end - start));
+			start = end + 1;
+		}
+		rest.erase(0, start);
+	}
+	bool ok = !ferror(f);
+	fileop::close(f);
+	if (!rest.empty()) feed(rest);
+	if (!parser.finish() || !ok) return false;
+	fonts.splice(fonts.end(), parser.fonts);
+	if (stripped) {
+		/* Without the extracted fonts, the copy would lose them. */
+		if (parser.hasFonts && !parser.fontsDir.empty()) stripped->swap(copy);
+		else stripped->clear();
+	}
+	return true;
+}
+
+#ifdef HAVE_FONTCONFIG
+static void addFile(const FcChar8* file, std::list<std::string>& files) {
+	if (!file) return;
+	std::string f((const char*)file);
+	if (std::find(files.begin(), files.end(), f) == files.end()) files.push_back(f);
+}
+
+/**
+ * @brief Add all faces whose object (family, full name or postscript name) is name
+ * @return true if any face is found
+*/
+static bool listFaces(FcConfig* fc, const char* object, const std::string& name, std::list<std::string>& files) {
+	auto p = FcPatternCreate();
+	FcPatternAddString(p, object, (const FcChar8*)name.c_str());
+	auto os = FcObjectSetBuild(FC_FILE, nullptr);
+	auto set = FcFontList(fc, p, os);
+	bool found = false;
+	if (set) {
+		for (int i = 0; i < set->nfont; i++) {
+			FcChar8* file = nullptr;
+			if (FcPatternGetString(set->fonts[i], FC_FILE, 0, &file) == FcResultMatch) {
+				addFile(file, files);
+				found = true;
+			}
+		}
+		FcFontSetDestroy(set);
+	}
+	FcObjectSetDestroy(os);
+	FcPatternDestroy(p);
+	return found;
+}
+
+/**
+ * @brief Get the substitute of a family which is not installed
+*/
+static std::string matchFace(FcConfig* fc, const std::string& name) {
+	auto p = FcPatternCreate();
+	FcPatternAddString(p, FC_FAMILY, (const FcChar8*)name.c_str());
+	FcConfigSubstitute(fc, p, FcMatchPattern);
+	FcDefaultSubstitute(p);
+	FcResult r;
+	auto m = FcFontMatch(fc, p, &r);
+	std::string re;
+	FcChar8* file = nullptr;
+	if (m && FcPatternGetString(m, FC_FILE, 0, &file) == FcResultMatch && file) re = (const char*)file;
+	if (m) FcPatternDestroy(m);
+	FcPatternDestroy(p);
+	return re;
+}
+
+/**
+ * @brief Add fonts covering text, the default sans-serif font is always added
+*/
+static void addFallback(FcConfig* fc, const std::string& text, std::list<std::string>& files) {
+	auto need = FcCharSetCreate();
+	auto s = (const FcChar8*)text.c_str();
+	int len = (int)text.length();
+	while (len > 0) {
+		FcChar32 c;
+		int n = FcUtf8ToUcs4(s, &c, len);
+		if (n <= 0) {
+			/* Not UTF-8, skip a byte. */
+			n = 1;
+		} else if (c > ' ') {
+			FcCharSetAddChar(need, c);
+		}
+		s += n;
+		len -= n;
+	}
+	auto p = FcPatternCreate();
+	FcPatternAddString(p, FC_FAMILY, (const FcChar8*)"sans-serif");
+	FcPatternAddCharSet(p, FC_CHARSET, need);
+	FcConfigSubstitute(fc, p, FcMatchPattern);
+	FcDefaultSubstitute(p);
+	FcResult r;
+	auto set = FcFontSort(fc, p, FcTrue, nullptr, &r);
+	if (set) {
+		int added = 0;
+		for (int i = 0; i < set->nfont && added < MAX_FALLBACK_FONTS; i++) {
+			FcCharSet* cs = nullptr;
+			bool useful = i == 0;
+			if (FcPatternGetCharSet(set->fonts[i], FC_CHARSET, 0, &cs) == FcResultMatch && cs && FcCharSetIntersectCount(need, cs)) {
+				auto left = FcCharSetSubtract(need, cs);
+				FcCharSetDestroy(need);
+				need = left;
+				useful = true;
+			}
+			if (!useful) continue;
+			FcChar8* file = nullptr;
+			if (FcPatternGetString(set->fonts[i], FC_FILE, 0, &file) == FcResultMatch) {
+				addFile(file, files);
+				added++;
+			}
+			if (!FcCharSetCount(need)) break;
+		}
+		FcFontSetDestroy(set);
+	}
+	FcPatternDestroy(p);
+	FcCharSetDestroy(need);
+}
+#endif
+
+bool assfonts::resolve(const std::list<std::string>& families, const std::string& text, std::list<std::string>& files) {
+#ifdef HAVE_FONTCONFIG
+	trace::scope t("assfonts::resolve");
+	auto fc = FcInitLoadConfigAndFonts();
+	if (!fc) return false;
+	for (auto i = families.begin(); i != families.end(); ++i) {
+		if (listFaces(fc, FC_FAMILY, *i, files) || listFaces(fc, FC_FULLNAME, *i, files) || listFaces(fc, FC_POSTSCRIPT_NAME, *i, files)) continue;
+		auto sub = matchFace(fc, *i);
+		if (sub.empty()) continue;
+		console::verbose("Font \"%s\" is not installed, \"%s\" is used instead.", i->c_str(), sub.c_str());
+		addFile((const FcChar8*)sub.c_str(), files);
+	}
+	addFallback(fc, text, files);
+	FcConfigDestroy(fc);
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::string assfonts::getConfigFile(const std::string& dir) {
+	return fileop::combilePath(dir, FONTS_CONFIG_NAME);
+}
+
+std::string assfonts::getEmbeddedDir(const std::string& dir) {
+	auto embedded = fileop::combilePath(dir, EMBEDDED_FONTS_DIR);
+	return fileop::exists(embedded) ? embedded : "";
+}
+
+static std::string escapeXml(const std::string& s) {
+	std::string re;
+	for (auto c : s) {
+		if (c == '&') re += "&amp;";
+		else if (c == '<') re += "&lt;";
+		else if (c == '>') re += "&gt;";
+		else re += c;
+	}
+	return re;
+}
+
+/**
+ * @brief Read a list file, one path per line
+*/
+static bool readList(const std::string& path, std::vector<std::string>& list) {
+	std::string data;
+	if (!fileop::readFile(path, data)) return false;
+	size_t start = 0;
+	while (start < data.length()) {
+		auto end = data.find('\n', start);
+		if (end == std::string::npos) end = data.length();
+		list.push_back(data.substr(start, end - start));
+		start = end + 1;
+	}
+	return true;
+}
+
+/**
+ * @brief Check whether all fonts and subtitles used by a prepared directory still exist
+ * @param subtitles Subtitles to use in the directory, one for every input
+*/
+static bool isPrepared(const std::string& dir, size_t count, std::vector<std::string>& subtitles) {
+	if (!fileop::exists(assfonts::getConfigFile(dir))) return false;
+	std::vector<std::string> fonts;
+	if (!readList(fileop::combilePath(dir, FONTS_LIST_NAME), fonts) || !readList(fileop::combilePath(dir, SUBTITLES_LIST_NAME), subtitles)) return false;
+	if (subtitles.size() != count) return false;
+	fonts.insert(fonts.end(), subtitles.begin(), subtitles.end());
+	for (auto i = fonts.begin(); i != fonts.end(); ++i) {
+		if (!i->empty() && !fileop::exists(*i)) return false;
+	}
+	return true;
+}
+
+#ifdef HAVE_FONTCONFIG
+/**
+ * @brief Link fonts into a directory
+ * @param list Sources are appended, one per line
+ * @return true if OK
+*/
+static bool linkFonts(const std::list<std::string>& files, const std::string& dir, std::string& list) {
+	if (files.empty()) return true;
+	if (!fileop::mkdirs(dir)) return false;
+	size_t n = 0;
+	for (auto i = files.begin(); i != files.end(); ++i, n++) {
+		/* Numbered, so faces with the same file name from different directories never clash. */
+		auto link = fileop::combilePath(dir, std::to_string(n) + "-" + std::string(pathview(*i).name()));
+		remove(link.c_str());
+		if (!fileop::link(*i, link)) {
+			console::verbose("Can not link font \"%s\" to \"%s\".", i->c_str(), link.c_str());
+			return false;
+		}
+		list += *i + "\n";
+	}
+	return true;
+}
+
+/**
+ * @brief Get conf.d next to the default fontconfig config, empty if unknown
+*/
+static std::string getSystemConfDir() {
+	auto file = FcConfigFilename(nullptr);
+	if (!file) return "";
+	auto dir = fileop::combilePath(pathview((const char*)file).dir(), "conf.d");
+	FcStrFree(file);
+	return dir;
+}
+
+/**
+ * @brief Remove families provided by embedded fonts, so they are not resolved to system fonts
+*/
+static void removeEmbeddedFamilies(const std::list<std::string>& fonts, std::list<std::string>& families) {
+	const char* objects[] = { FC_FAMILY, FC_FULLNAME, FC_POSTSCRIPT_NAME };
+	for (auto f = fonts.begin(); f != fonts.end() && !families.empty(); ++f) {
+		int count = 0;
+		for (int id = 0; id < 1 || id < count; id++) {
+			auto p = FcFreeTypeQuery((const FcChar8*)f->c_str(), id, nullptr, &count);
+			if (!p) break;
+			for (auto o : objects) {
+				FcChar8* name = nullptr;
+				for (int n = 0; FcPatternGetString(p, o, n, &name) == FcResultMatch; n++) {
+					families.remove_if([name](const std::string& s) { return util::equalsIgnoreCase(s, (const char*)name); });
+				}
+			}
+			FcPatternDestroy(p);
+		}
+	}
+}
+#endif
+
+/**
+ * @brief Get the directory of prepared fonts for subtitles, any change of subtitles gives a new directory
+ * @return the directory, empty if failed
+*/
+static std::string getPreparedDir(const std::list<std::string>& subtitles) {
+	if (subtitles.empty()) return "";
+	uint64_t h = FNV1A_INIT;
+	for (auto i = subtitles.begin(); i != subtitles.end(); ++i) {
+		fileop::fileid id;
+		if (!fileop::getFileId(*i, id)) return "";
+		h = util::fnv1a(h, i->c_str(), i->length() + 1);
+		h = util::fnv1a(h, &id.size, sizeof(id.size));
+		h = util::fnv1a(h, &id.mtime, sizeof(id.mtime));
+	}
+	auto cache = fileop::getCacheDir();
+	if (cache.empty()) return "";
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)h);
+	return fileop::combilePath(fileop::combilePath(cache, "fonts"), name);
+}
+
+std::string assfonts::find(std::list<std::string>& subtitles) {
+#ifdef HAVE_FONTCONFIG
+	auto dir = getPreparedDir(subtitles);
+	std::vector<std::string> used;
+	if (dir.empty() || !isPrepared(dir, subtitles.size(), used)) return "";
+	console::verbose("Use resolved fonts of subtitles: %s", dir.c_str());
+	/* Directories can not be touched on Windows, the cache trimming checks files in it too. */
+	fileop::touch(fileop::combilePath(dir, FONTS_LIST_NAME));
+	/* Shared extracted fonts are only touched when a script is parsed, keep the linked ones. */
+	filelist linked;
+	auto embedded = fileop::combilePath(dir, EMBEDDED_FONTS_DIR);
+	if (fileop::listdir(embedded, linked)) {
+		for (auto i = linked.begin(); i != linked.end(); ++i) fileop::touch(std::string(*i));
+	}
+	size_t n = 0;
+	for (auto i = subtitles.begin(); i != subtitles.end(); ++i, n++) {
+		if (!used[n].empty()) *i = used[n];
+	}
+	return dir;
+#else
+	return "";
+#endif
+}
+
+std::string assfonts::prepare(std::list<std::string>& subtitles) {
+#ifdef HAVE_FONTCONFIG
+	trace::scope t("assfonts::prepare");
+	auto found = find(subtitles);
+	if (!found.empty()) return found;
+	auto dir = getPreparedDir(subtitles);
+	if (dir.empty() || !fileop::mkdirs(dir)) return "";
+	std::list<std::string> families, embedded;
+	std::string text, sublist;
+	std::vector<std::string> used;
+	for (auto i = subtitles.begin(); i != subtitles.end(); ++i) {
+		std::string stripped;
+		if (!scan(*i, families, &text, embedded, &stripped)) {
+			console::verbose("Can not read subtitles or extract fonts: %s", i->c_str());
+			return "";
+		}
+		std::string copy;
+		if (!stripped.empty()) {
+			copy = fileop::combilePath(dir, std::to_string(used.size()) + "-" + std::string(pathview(*i).name()));
+			if (!fileop::writeFile(copy, stripped.c_str(), stripped.length())) return "";
+		}
+		sublist += copy + "\n";
+		used.push_back(copy);
+	}
+	removeEmbeddedFamilies(embedded, families);
+	std::list<std::string> files;
+	if (!resolve(families, text, files)) return "";
+	if (files.empty() && embedded.empty()) return "";
+	std::string list;
+	if (!linkFonts(files, fileop::combilePath(dir, SYSTEM_FONTS_DIR), list) || !linkFonts(embedded, fileop::combilePath(dir, EMBEDDED_FONTS_DIR), list)) return "";
+	/* System fonts are found through fontconfig, which only opens the faces libass asks for.
+	 * The user's rules in conf.d (aliases, hinting, substitutions) still apply. */
+	std::string conf = "<?xml version=\"1.0\"?>\n<!DOCTYPE fontconfig SYSTEM \"urn:fontconfig:fonts.dtd\">\n<fontconfig>\n";
+	auto confd = getSystemConfDir();
+	if (!confd.empty()) conf += "\t<include ignore_missing=\"yes\">" + escapeXml(confd) + "</include>\n";
+	conf += "\t<dir>" + escapeXml(fileop::combilePath(dir, SYSTEM_FONTS_DIR)) + "</dir>\n\t<cachedir>"
+		+ escapeXml(fileop::combilePath(dir, "fccache")) + "</cachedir>\n</fontconfig>\n";
+	/* The config is the mark of a complete directory, so it is written last. */
+	if (!fileop::writeFile(fileop::combilePath(dir, FONTS_LIST_NAME), list.c_str(), list.length())
+		|| !fileop::writeFile(fileop::combilePath(dir, SUBTITLES_LIST_NAME), sublist.c_str(), sublist.length())
+		|| !fileop::writeFile(getConfigFile(dir), conf.c_str(), conf.length())) return "";
+	console::verbose("Resolved %zu font families of subtitles to %zu files, %zu fonts are embedded: %s", families.size(), files.size(), embedded.size(), dir.c_str());
+	size_t n = 0;
+	for (auto i = subtitles.begin(); i != subtitles.end(); ++i, n++) {
+		if (!used[n].empty()) *i = used[n];
+	}
+	return dir;
+#else
+	return "";
+#endif
+}
@@ -0,0 +1,76 @@
+#ifndef _ST_ASSFONTS_H
+#define _ST_ASSFONTS_H
+
+#include <list>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Resolve fonts used by ASS subtitles, so libass can be given only them.
+ * On a cold fontconfig cache, libass scans every installed font before the first frame.
+ * With a directory holding only the used fonts and a fontconfig config listing only that directory,
+ * it only loads a few files.
+*/
+namespace assfonts {
+	/**
+	 * @brief Collect font families used by an ASS script: Fontname of styles and \fn overrides of events
+	 * @param data The script
+	 * @param families Result without duplicates (case insensitive). `@` of vertical fonts is removed.
+	 * @param text Characters shown by events, override blocks are removed. Can be NULL if don't needed.
+	*/
+	void getFamilies(std::string_view data, std::list<std::string>& families, std::string* text = nullptr);
+	/**
+	 * @brief Read an ASS script in chunks: collect font families like getFamilies, and extract fonts embedded in [Fonts].
+	 * Embedded fonts are named by their content in the cache, a font extracted before is not decoded again.
+	 * @param path The script
+	 * @param families Font families
+	 * @param text Characters shown by events. Can be NULL if don't needed.
+	 * @param fonts Extracted font files
+	 * @param stripped The script without [Fonts] if it has embedded fonts, or empty. Can be NULL if don't needed.
+	 * @return false if can not read the script or extract fonts
+	*/
+	bool scan(const std::string& path, std::list<std::string>& families, std::string* text, std::list<std::string>& fonts, std::string* stripped = nullptr);
+	/**
+	 * @brief Decode a font embedded in [Fonts], which uses a variant of uuencode: every 4 characters hold 3 bytes, 6 bits each offset by 33
+	 * @param in Encoded data, lines must be joined
+	 * @param out Result
+	*/
+	void uudecode(std::string_view in, std::string& out);
+	/**
+	 * @brief Resolve families to font files with fontconfig. Fallback fonts covering text are added too.
+	 * Families which are not installed are resolved to their substitutes, as libass would do.
+	 * @param families Font families
+	 * @param text Characters in UTF-8 which must be covered
+	 * @param files Font files
+	 * @return false if fontconfig is not available
+	*/
+	bool resolve(const std::list<std::string>& families, const std::string& text, std::list<std::string>& files);
+	/**
+	 * @brief Prepare the fonts used by subtitles, cached by the identities of subtitles, so fonts are resolved and extracted once.
+	 * The directory holds a fontconfig config (see getConfigFile) whose only font directory has links to the used system fonts,
+	 * and a directory of extracted embedded fonts for fontsdir of the subtitles filter (see getEmbeddedDir).
+	 * @param subtitles ASS subtitles. Ones with embedded fonts are replaced by cached copies without them,
+	 * so libass does not decode the fonts on every open.
+	 * @return the directory, empty if failed
+	*/
+	std::string prepare(std::list<std::string>& subtitles);
+	/**
+	 * @brief Find the directory already prepared for subtitles, without resolving anything. Subtitles are replaced as prepare does.
+	 * @param subtitles ASS subtitles
+	 * @return the directory, empty if not prepared yet
+	*/
+	std::string find(std::list<std::string>& subtitles);
+	/**
+	 * @brief Get the fontconfig config file in a directory from prepare. It keeps the rules of the system conf.d,
+	 * but only lists the used system fonts, so fontconfig does not scan all installed fonts.
+	*/
+	std::string getConfigFile(const std::string& dir);
+	/**
+	 * @brief Get the directory of extracted embedded fonts in a directory from prepare.
+	 * Only font files are in it, libass reads every file there as a font.
+	 * @return the directory, empty if subtitles have no embedded fonts
+	*/
+	std::string getEmbeddedDir(const std::string& dir);
+}
+
+#endif
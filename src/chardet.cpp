@@ -5,8 +5,10 @@
 #include "config.h"
 #endif
 #include "console.h"
+#include "trace.h"
 
 bool chardet::det(const char* buff, size_t buff_len, char*& encoding, float* confidence, short& bom) {
+	trace::scope t("chardet::det");
 	auto obj = detect_obj_init();
 	if (!obj) {
 		console::info("Can not allocate enough memory for detect obj.");
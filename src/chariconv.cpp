@@ -34,19 +34,22 @@ bool iconv_convert(const char* input, size_t input_size, char*& output, size_t&
 		}
 		return false;
 	}
-	char* first = (char*)malloc(input_size);
+	/* Tiny inputs still need room for a multi-byte character and the terminator. */
+	size_t step = input_size < 64 ? 64 : input_size;
+	char* first = (char*)malloc(step);
 	char* now = first;
 	char* now_in = (char*)input;
-	size_t all = input_size;
-	size_t avail_out = input_size, avail_in = input_size;
+	size_t all = step;
+	size_t avail_out = step, avail_in = input_size;
+	bool full = false;
 	if (!first) {
-		console::warn("Can not allocate memory, needed size: %zi.", input_size);
+		console::warn("Can not allocate memory, needed size: %zi.", step);
 		if (iconv_close(cd)) console::verbose("An error occured when closing iconv.");
 		return false;
 	}
 	while (avail_in >= 0) {
-		if (avail_out < input_size) {
-			size_t needed = all + input_size;
+		if (full || avail_out < input_size || avail_out == 0) {
+			size_t needed = all + step;
 			char* newstr = (char*)realloc(first, needed);
 			if (!newstr) {
 				console::warn("Can not reallocate memory, needed size: %zi.", needed);
@@ -54,15 +57,19 @@ bool iconv_convert(const char* input, size_t input_size, char*& output, size_t&
 				if (iconv_close(cd)) console::verbose("An error occured when closing iconv.");
 				return false;
 			}
-			if (newstr != first) {
-				now = newstr + (all - avail_out);
-			}
+			now = newstr + (all - avail_out);
 			first = newstr;
-			all += input_size;
-			avail_out += input_size;
+			all += step;
+			avail_out += step;
+			full = false;
 		}
 		if (avail_in > 0) {
-			if (iconv(cd, &now_in, &avail_in, &now, &avail_out) == -1) {
+			/* Output is bigger than input (such as GBK to UTF-8), grow the buffer and continue. */
+			if (iconv(cd, &now_in, &avail_in, &now, &avail_out) == (size_t)-1) {
+				if (errno == E2BIG) {
+					full = true;
+					continue;
+				}
 				console::verbose("An error occured when converting from '%s' to '%s'.", ori_enc, des_enc);
 				free(first);
 				if (iconv_close(cd)) console::verbose("An error occured when closing iconv.");
@@ -9,6 +9,10 @@ cml::cml(int argc, char** argv) {
 	struct option opts[] = { {"help", 0, nullptr, 'h'},
 		{"verbose", 0, nullptr, 'v'},
 		{"quiet", 0, nullptr, 'q'},
+#define EXEC_MODE 130
+		{"exec", 0, nullptr, EXEC_MODE},
+#define TRACE_FILE 131
+		{"trace", 1, nullptr, TRACE_FILE},
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #define RECOVERY_OUTPUT_CP 129
 		{"rcp", 0, nullptr, RECOVERY_OUTPUT_CP},
@@ -39,6 +43,13 @@ cml::cml(int argc, char** argv) {
 			console::verbose("Get need print help message from command line.");
 			help = true;
 			break;
+		case EXEC_MODE:
+			console::verbose("Will replace current process with ffplay.");
+			exec = true;
+			break;
+		case TRACE_FILE:
+			if (optarg) trace = optarg;
+			break;
 		case ':':
 			help = true;
 			has_error = true;
@@ -116,7 +127,9 @@ bool cml::print_help() {
 		} else {
 			console::info("Available options:\n\
 -v	--verbose	Enable verbose logging.\n\
--q	--quiet		Be quiet.\n");
+-q	--quiet		Be quiet.\n\
+	--exec		Replace ffplay-starter with ffplay instead of waiting ffplay exit.\n\
+	--trace=FILE	Write the time spent in every startup phase to FILE (Chrome trace event format).\n");
 #if defined(_WIN32) && !defined(__CYGWIN__)
 			console::info("\
 	--rcp		Recovery origin output code page after the program execute.");
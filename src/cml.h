@@ -9,6 +9,10 @@ private:
 	bool has_error = false;
 public:
 	std::string filename = "";
+	/// Replace current process with ffplay instead of waiting it
+	bool exec = false;
+	/// Write startup trace to this file if not empty
+	std::string trace = "";
 	cml(int argc, char** argv);
 	/**
 	 * \brief print help if help is needed.
@@ -2,10 +2,56 @@
 #define _ST_CONFIGFILE_H
 
 #include <string>
+#include <list>
+
+/**
+ * @brief Weights of ranking external subtitles, see subresolver
+*/
+typedef struct subscore {
+	/// Added for a preferred language, multiplied by its rank from the end of the list
+	int language = 100;
+	/// Added if the subtitle has no language tag
+	int untagged = 20;
+	int ass = 40;
+	int ssa = 35;
+	int srt = 30;
+	int vtt = 20;
+	int sup = 10;
+	/// Added if the subtitle is next to the video
+	int sameDirectory = 10;
+	/// Added if the subtitle is in Subs/ or Subtitles/
+	int subdirectory = 0;
+	/// Added if the subtitle only has forced lines
+	int forced = -60;
+	/// Added if the subtitle is for the deaf and hard of hearing
+	int sdh = -20;
+} subscore;
 
 class config {
 public:
-	std::string ffplay = "";
+	/// ffplay candidates, the first working one will be used
+	std::list<std::string> ffplay;
+	/// Timeout of testing a ffplay candidate in milliseconds
+	int probeTimeout = 3000;
+	/// Read ffplay and its shared libraries into page cache in background
+	bool prefetch = true;
+	/// The size in MiB read ahead at the head and the tail of media file, 0 to disable
+	int readaheadSize = 4;
+	/// Keep a persistent file name index of big directories to find relative files
+	bool dirIndex = true;
+	/// The longest time in milliseconds to wait listing relative files before starting ffplay, negative means no limit
+	int scanTimeout = 1000;
+	/// Preferred subtitle languages like `zh` or `en`, earlier ones are ranked higher. Common English names (`English`) and ISO 639-2 codes (`eng`) in file names match them too.
+	std::list<std::string> subtitleLanguages;
+	/// The max count of external subtitles rendered at the same time, negative means no limit
+	int maxSubtitles = 1;
+	subscore subtitleScore;
+	/// Give libass only the fonts used by ASS subtitles, so it doesn't scan all installed fonts
+	bool assFonts = true;
+	/// Convert text subtitles not in UTF-8 to a cached UTF-8 copy, otherwise ffplay is told their encoding (charenc)
+	bool transcodeSubtitles = true;
+	/// Remove cached files not used for so many days, 0 or negative to keep them
+	int cacheDays = 30;
 	int width = -1;
 	bool autoExit = false;
 };
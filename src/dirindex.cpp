@@ -0,0 +1,238 @@
+#include "dirindex.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "console.h"
+#include "fsbackend.h"
+#include "util.h"
+
+#define DIRINDEX_MAGIC "STDIDX01"
+/// Changes within this time of the last modification may be missed by mtime
+#define DIRINDEX_RACY_NS 2000000000LL
+
+/**
+ * File layout: header, directory path (padded to 8 bytes), records sorted by name, names (NUL terminated).
+*/
+typedef struct dirindex_header {
+	char magic[8];
+	uint64_t dev;
+	uint64_t ino;
+	int64_t mtime;
+	int64_t ctime;
+	uint32_t count;
+	uint32_t pathlen;
+	uint32_t namessize;
+	uint32_t reserved;
+} dirindex_header;
+
+typedef struct dirindex_record {
+	/// Offset in names
+	uint32_t name;
+	uint16_t len;
+	/// Length of the name before the first `.`
+	uint16_t stem;
+	/// Offset of the last `.`, equals len if no ext
+	uint16_t ext;
+	uint8_t type;
+	uint8_t reserved;
+} dirindex_record;
+
+inline size_t align8(size_t n) {
+	return (n + 7) & ~(size_t)7;
+}
+
+/**
+ * @brief Get the path of the index file of a directory
+ * @param dir Directory path ends with path separator
+ * @param create Whether to create the index directory
+ * @return the path, if failed, will be empty
+*/
+std::string getIndexPath(const std::string& dir, bool create) {
+	auto cache = fileop::getCacheDir();
+	if (cache.empty()) return "";
+	auto idir = fileop::combilePath(cache, "dirindex");
+	if (create && !fileop::mkdirs(idir)) return "";
+	uint64_t h = util::fnv1a(FNV1A_INIT, dir.data(), dir.length());
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.idx", (unsigned long long)h);
+	return fileop::combilePath(idir, name);
+}
+
+/**
+ * @brief Normalize directory path like dirscan does
+*/
+std::string normalizeDirectory(std::string path) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	util::strreplace(path, "/", "\\");
+	if (!path.empty() && path.back() != '\\') path += '\\';
+#else
+	util::strreplace(path, "\\", "/");
+	if (!path.empty() && path.back() != '/') path += '/';
+#endif
+	return path;
+}
+
+dirindex::~dirindex() {
+	close();
+}
+
+void dirindex::close() {
+#if !defined(_WIN32) || defined(__CYGWIN__)
+	if (mapped) munmap((void*)data, length);
+#endif
+	mapped = false;
+	data = nullptr;
+	length = 0;
+	buffer.clear();
+}
+
+bool dirindex::open(std::string path, bool validate) {
+	close();
+	if (path.empty()) return false;
+	dir = normalizeDirectory(path);
+	auto ipath = getIndexPath(dir, false);
+	if (ipath.empty()) return false;
+	fileop::fileid id;
+	if (validate && !fileop::getFileId(dir, id)) return false;
+	/* Only files of the operating system can be mapped. */
+	bool map = fileop::backend().native();
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	map = false;
+#endif
+	if (!map) {
+		if (!fileop::readFile(ipath, buffer, 256 * 1024 * 1024)) return false;
+		data = buffer.c_str();
+		length = buffer.length();
+	}
+#if !defined(_WIN32) || defined(__CYGWIN__)
+	else {
+		int fd = ::open(ipath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd == -1) return false;
+		struct stat st;
+		if (fstat(fd, &st) || (size_t)st.st_size < sizeof(dirindex_header)) {
+			::close(fd);
+			return false;
+		}
+		auto p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED) return false;
+		data = (const char*)p;
+		length = st.st_size;
+		mapped = true;
+	}
+#endif
+	auto h = (const dirindex_header*)data;
+	bool ok = length >= sizeof(dirindex_header) && !memcmp(h->magic, DIRINDEX_MAGIC, 8);
+	if (ok) {
+		size_t need = sizeof(dirindex_header) + align8(h->pathlen) + (size_t)h->count * sizeof(dirindex_record) + h->namessize;
+		ok = need <= length && h->pathlen == dir.length() && !memcmp(data + sizeof(dirindex_header), dir.c_str(), dir.length());
+	}
+	if (ok && validate && (h->dev != id.dev || h->ino != id.ino || h->mtime != id.mtime || h->ctime != id.ctime)) {
+		console::verbose("Directory index of '%s' is stale.", dir.c_str());
+		ok = false;
+	}
+	if (!ok) close();
+	/* Keep a used index from being trimmed, see fileop::trimCache */
+	else fileop::touch(ipath);
+	return ok;
+}
+
+size_t dirindex::size() const {
+	if (!data) return 0;
+	return ((const dirindex_header*)data)->count;
+}
+
+bool dirindex::find(std::string_view prefix, std::vector<dirscan::entry>& result) const {
+	if (!data) return false;
+	auto h = (const dirindex_header*)data;
+	auto records = (const dirindex_record*)(data + sizeof(dirindex_header) + align8(h->pathlen));
+	auto names = (const char*)(records + h->count);
+	auto end = records + h->count;
+	auto name = [names, h](const dirindex_record& r) {
+		if ((size_t)r.name + r.len >= h->namessize) return std::string_view();
+		return std::string_view(names + r.name, r.len);
+	};
+	auto i = std::lower_bound(records, end, prefix, [&name](const dirindex_record& r, std::string_view p) {
+		return name(r) < p;
+	});
+	for (; i != end; ++i) {
+		auto n = name(*i);
+		if (n.empty()) return false;
+		if (n.compare(0, prefix.length(), prefix)) break;
+		dirscan::entry e;
+		e.name = n;
+		e.type = (dirscan::entry_type)i->type;
+		result.push_back(e);
+	}
+	return true;
+}
+
+std::string dirindex::fullpath(std::string_view name) const {
+	std::string s;
+	s.reserve(dir.length() + name.length());
+	s += dir;
+	s += name;
+	return s;
+}
+
+bool dirindex::store(const dirscan& scanner, const fileop::fileid& id) {
+	auto& dir = scanner.directory();
+	auto& entries = scanner.entries();
+	auto ipath = getIndexPath(dir, true);
+	if (ipath.empty()) return false;
+	std::vector<const dirscan::entry*> sorted;
+	sorted.reserve(entries.size());
+	size_t namessize = 0;
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		if (i->name.length() > UINT16_MAX) return false;
+		sorted.push_back(&*i);
+		namessize += i->name.length() + 1;
+	}
+	if (namessize > UINT32_MAX) return false;
+	std::sort(sorted.begin(), sorted.end(), [](const dirscan::entry* a, const dirscan::entry* b) {
+		return a->name < b->name;
+	});
+	size_t recordsoff = sizeof(dirindex_header) + align8(dir.length());
+	size_t namesoff = recordsoff + sorted.size() * sizeof(dirindex_record);
+	std::string data(namesoff + namessize, '\0');
+	auto h = (dirindex_header*)&data[0];
+	memcpy(h->magic, DIRINDEX_MAGIC, 8);
+	h->dev = id.dev;
+	h->ino = id.ino;
+	h->mtime = id.mtime;
+	h->ctime = id.ctime;
+	h->count = (uint32_t)sorted.size();
+	h->pathlen = (uint32_t)dir.length();
+	h->namessize = (uint32_t)namessize;
+	memcpy(&data[sizeof(dirindex_header)], dir.c_str(), dir.length());
+	auto records = (dirindex_record*)&data[recordsoff];
+	size_t off = 0;
+	for (auto e : sorted) {
+		auto& n = e->name;
+		auto& r = *records++;
+		r.name = (uint32_t)off;
+		r.len = (uint16_t)n.length();
+		auto first = n.find('.');
+		auto last = n.rfind('.');
+		r.stem = (uint16_t)(first == std::string_view::npos ? n.length() : first);
+		r.ext = (uint16_t)(last == std::string_view::npos ? n.length() : last);
+		r.type = e->type;
+		memcpy(&data[namesoff + off], n.data(), n.length());
+		off += n.length() + 1;
+	}
+	return fileop::writeFile(ipath, data.c_str(), data.length());
+}
+
+bool dirindex::isRacy(const fileop::fileid& id) {
+	auto now = (long long)time(nullptr) * 1000000000LL;
+	return now - id.mtime < DIRINDEX_RACY_NS;
+}
@@ -0,0 +1,77 @@
+#ifndef _ST_DIRINDEX_H
+#define _ST_DIRINDEX_H
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "dirscan.h"
+#include "fileop.h"
+
+/// Directories with less entries are scanned directly
+#define DIRINDEX_MIN_ENTRIES 256
+
+/**
+ * @brief Persistent sorted file name index of a directory, stored in cache directory.
+ * The index is mapped into memory and checked against the directory's identity, mtime and ctime,
+ * so a lookup is a binary search instead of reading the whole directory.
+*/
+class dirindex {
+public:
+	dirindex() = default;
+	dirindex(const dirindex&) = delete;
+	dirindex& operator=(const dirindex&) = delete;
+	~dirindex();
+	/**
+	 * @brief Open the index of a directory
+	 * @param path The directory path
+	 * @param validate Whether to check the directory is not changed. Without checking, the directory is never accessed.
+	 * @return false if the index not exists, is broken or the directory is changed after the index was built
+	*/
+	bool open(std::string path, bool validate = true);
+	/**
+	 * @brief Find all entries whose name starts with prefix
+	 * @param prefix The prefix
+	 * @param result Entries in name order, names point into the mapped index
+	 * @return false if the index is broken
+	*/
+	bool find(std::string_view prefix, std::vector<dirscan::entry>& result) const;
+	/**
+	 * @brief Get the count of entries
+	*/
+	size_t size() const;
+	/**
+	 * @brief Get the directory of the index, always ends with path separator
+	*/
+	const std::string& directory() const {
+		return dir;
+	}
+	/**
+	 * @brief Build full path of a name
+	*/
+	std::string fullpath(std::string_view name) const;
+	/**
+	 * @brief Build the index from a full scan and write it
+	 * @param scanner A scanner which listed the whole directory
+	 * @param id The identity of the directory taken before scanning
+	 * @return true if OK
+	*/
+	static bool store(const dirscan& scanner, const fileop::fileid& id);
+	/**
+	 * @brief Check whether the directory was modified too recently.
+	 * Changes in the same timestamp tick can not be noticed, so such a directory should not be indexed yet.
+	 * @param id The identity of the directory
+	 * @return true if racy
+	*/
+	static bool isRacy(const fileop::fileid& id);
+private:
+	const char* data = nullptr;
+	size_t length = 0;
+	bool mapped = false;
+	/// Used when the index can not be mapped
+	std::string buffer;
+	std::string dir;
+	void close();
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "dirscan.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <string.h>
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "console.h"
+#include "fileop.h"
+#include "fsbackend.h"
+#include "util.h"
+
+#ifdef HAVE_READDIR64
+#define readdir readdir64
+#define dirent dirent64
+#endif
+
+#define DIRSCAN_BLOCK_SIZE (64 * 1024)
+#ifdef HAVE_GETDENTS64
+/// Enough for one record with the longest name
+#define DIRSCAN_MIN_FREE (sizeof(struct dirent64) + 8)
+#endif
+
+char* dirscan::reserve(size_t size) {
+	if (blocks.empty() || capacity - used < size) {
+		capacity = size > DIRSCAN_BLOCK_SIZE ? size : DIRSCAN_BLOCK_SIZE;
+		blocks.push_back(std::unique_ptr<char[]>(new char[capacity]));
+		used = 0;
+	}
+	return blocks.back().get() + used;
+}
+
+void dirscan::add(const char* name, size_t len, entry_type t) {
+	auto p = reserve(len + 1);
+	memcpy(p, name, len);
+	p[len] = 0;
+	used += len + 1;
+	entry e;
+	e.name = std::string_view(p, len);
+	e.type = t;
+	items.push_back(e);
+}
+
+#if !defined(_WIN32) || defined(__CYGWIN__)
+dirscan::entry_type convertType(unsigned char t) {
+	switch (t) {
+	case DT_REG:
+		return dirscan::FILE;
+	case DT_DIR:
+		return dirscan::DIRECTORY;
+	case DT_LNK:
+		return dirscan::LINK;
+	case DT_UNKNOWN:
+		return dirscan::UNKNOWN;
+	default:
+		return dirscan::OTHER;
+	}
+}
+#endif
+
+/**
+ * @brief Check whether a NUL terminated name starts with prefix
+*/
+inline bool startsWith(const char* name, std::string_view prefix) {
+	return !strncmp(name, prefix.data(), prefix.length());
+}
+
+bool dirscan::scan(std::string path, std::string_view prefix, bool countSkipped) {
+	items.clear();
+	dropped = 0;
+	counting = countSkipped;
+	/* Keep the first block for reuse. */
+	if (blocks.size() > 1) blocks.resize(1);
+	used = 0;
+	if (!blocks.empty()) capacity = DIRSCAN_BLOCK_SIZE;
+	if (path.empty()) return false;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	util::strreplace(path, "/", "\\");
+	if (path.back() != '\\') path += '\\';
+#else
+	util::strreplace(path, "\\", "/");
+	if (path.back() != '/') path += '/';
+#endif
+	dir = path;
+	return fileop::backend().listdir(dir, prefix, *this);
+}
+
+bool nativebackend::listdir(const std::string& dir, std::string_view prefix, dirscan& out) {
+	return out.readNative(dir, prefix);
+}
+
+bool dirscan::readNative(const std::string& path, std::string_view prefix) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	filelist fl;
+	/* Let the file system match the prefix. Fails if nothing matches, so list all then. */
+	if (prefix.empty() || counting || !fileop::win32FindFile((path + std::string(prefix) + "*").c_str(), fl)) {
+		if (!fileop::win32FindFile((path + "*").c_str(), fl)) return false;
+	}
+	for (size_t i = 0; i < fl.size(); i++) {
+		if (startsWith(fl.c_str(i), prefix)) add(fl.c_str(i), fl[i].length(), UNKNOWN);
+		else dropped++;
+	}
+#else
+#ifdef HAVE_GETDENTS64
+	int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1) {
+		console::verbose("open(%s) failed.", path.c_str());
+		return false;
+	}
+	/* Without prefix, raw records are read into the arena directly and names are used in place.
+	 * With prefix, records are read into a reused buffer and only matched names are copied. */
+	if (!prefix.empty() && !scratch) scratch.reset(new char[DIRSCAN_BLOCK_SIZE]);
+	while (true) {
+		char* buf;
+		size_t size;
+		if (prefix.empty()) {
+			buf = reserve(DIRSCAN_MIN_FREE);
+			size = capacity - used;
+		} else {
+			buf = scratch.get();
+			size = DIRSCAN_BLOCK_SIZE;
+		}
+		auto n = getdents64(fd, buf, size);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			console::verbose("getdents64(%s) failed.", path.c_str());
+			close(fd);
+			return false;
+		}
+		if (n == 0) break;
+		if (prefix.empty()) used += n;
+		for (ssize_t off = 0; off < n;) {
+			auto d = (struct dirent64*)(buf + off);
+			off += d->d_reclen;
+			if (d->d_name[0] == '.') continue;
+			if (prefix.empty()) {
+				entry e;
+				e.name = std::string_view(d->d_name);
+				e.type = convertType(d->d_type);
+				items.push_back(e);
+			} else if (startsWith(d->d_name, prefix)) {
+				add(d->d_name, strlen(d->d_name), convertType(d->d_type));
+			} else {
+				dropped++;
+			}
+		}
+	}
+	close(fd);
+#else
+	auto d = opendir(path.c_str());
+	if (!d) {
+		console::verbose("opendir(%s) failed.", path.c_str());
+		return false;
+	}
+	struct dirent* e;
+	while ((e = readdir(d))) {
+		if (e->d_name[0] == '.') continue;
+		if (!startsWith(e->d_name, prefix)) {
+			dropped++;
+			continue;
+		}
+#ifdef _DIRENT_HAVE_D_TYPE
+		add(e->d_name, strlen(e->d_name), convertType(e->d_type));
+#else
+		add(e->d_name, strlen(e->d_name), UNKNOWN);
+#endif
+	}
+	closedir(d);
+#endif
+#endif
+	return true;
+}
+
+std::string dirscan::fullpath(const entry& e) const {
+	std::string s;
+	s.reserve(dir.length() + e.name.length());
+	s += dir;
+	s += e.name;
+	return s;
+}
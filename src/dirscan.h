@@ -0,0 +1,98 @@
+#ifndef _ST_DIRSCAN_H
+#define _ST_DIRSCAN_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Read all entries of a directory into one arena.
+ * Names are kept as string_view pointing into the arena, so a scan only allocates a few big blocks.
+ * Entries are valid until the next scan or the scanner is destroyed.
+*/
+class dirscan {
+public:
+	enum entry_type : unsigned char {
+		/// The file system don't report the type
+		UNKNOWN,
+		FILE,
+		DIRECTORY,
+		LINK,
+		OTHER,
+	};
+	typedef struct entry {
+		/// File name, always followed by a NUL character
+		std::string_view name;
+		entry_type type = UNKNOWN;
+	} entry;
+	/**
+	 * @brief List a directory, entries starting with `.` are skipped
+	 * @param path The directory path
+	 * @param prefix Only keep entries whose name starts with it. Other entries are dropped while reading
+	 * without copying, so memory use depends on the count of matched entries.
+	 * @param countSkipped Count the dropped entries exactly, see skipped. On Windows the file name pattern
+	 * is not used then, as the file system drops entries without telling how many.
+	 * @return true if OK
+	*/
+	bool scan(std::string path, std::string_view prefix = std::string_view(), bool countSkipped = false);
+	/**
+	 * @brief Get the entries of last scan
+	*/
+	const std::vector<entry>& entries() const {
+		return items;
+	}
+	/**
+	 * @brief Get the directory of last scan, always ends with path separator
+	*/
+	const std::string& directory() const {
+		return dir;
+	}
+	/**
+	 * @brief Get the count of entries dropped by prefix in last scan, only exact if countSkipped was set
+	*/
+	size_t skipped() const {
+		return dropped;
+	}
+	/**
+	 * @brief Build full path of an entry
+	 * @param e The entry
+	 * @return the full path
+	*/
+	std::string fullpath(const entry& e) const;
+	/**
+	 * @brief Copy a name into the arena and add an entry. Used by file system backends.
+	*/
+	void add(const char* name, size_t len, entry_type t);
+	/**
+	 * @brief Count an entry dropped by prefix. Used by file system backends.
+	*/
+	void skip() {
+		dropped++;
+	}
+private:
+	friend class nativebackend;
+	std::vector<std::unique_ptr<char[]>> blocks;
+	/// Buffer for raw records when scanning with prefix
+	std::unique_ptr<char[]> scratch;
+	/// Used bytes of the last block
+	size_t used = 0;
+	size_t capacity = 0;
+	std::string dir;
+	std::vector<entry> items;
+	size_t dropped = 0;
+	bool counting = false;
+	/**
+	 * @brief Get at least size bytes free space at the end of the arena
+	*/
+	char* reserve(size_t size);
+	/**
+	 * @brief List a directory by operating system
+	 * @param path The directory path ends with path separator
+	 * @param prefix See scan
+	 * @return true if OK
+	*/
+	bool readNative(const std::string& path, std::string_view prefix);
+};
+
+#endif
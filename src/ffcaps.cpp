@@ -0,0 +1,108 @@
+#include "ffcaps.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <list>
+#include <thread>
+#include "fileop.h"
+
+typedef struct caps_name {
+	const char* name;
+	ffcaps::capability cap;
+} caps_name;
+
+static const caps_name filter_names[] = { { "subtitles", ffcaps::FILTER_SUBTITLES }, { "ass", ffcaps::FILTER_ASS }, { "scale", ffcaps::FILTER_SCALE }, { nullptr, ffcaps::PROBED } };
+static const caps_name protocol_names[] = { { "file", ffcaps::PROTOCOL_FILE }, { "cache", ffcaps::PROTOCOL_CACHE }, { nullptr, ffcaps::PROBED } };
+static const caps_name decoder_names[] = { { "ass", ffcaps::DECODER_ASS }, { "ssa", ffcaps::DECODER_SSA }, { "subrip", ffcaps::DECODER_SUBRIP }, { "webvtt", ffcaps::DECODER_WEBVTT }, { "pgssub", ffcaps::DECODER_PGSSUB }, { nullptr, ffcaps::PROBED } };
+static const caps_name build_names[] = { { "--enable-libass", ffcaps::BUILD_LIBASS }, { "--enable-libfontconfig", ffcaps::BUILD_FONTCONFIG }, { nullptr, ffcaps::PROBED } };
+
+/**
+ * @brief Split a line to whitespace separated tokens
+*/
+std::list<std::string> splitTokens(const std::string& line) {
+	std::list<std::string> re;
+	size_t i = 0, len = line.length();
+	while (i < len) {
+		while (i < len && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+		auto start = i;
+		while (i < len && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') i++;
+		if (i > start) re.push_back(line.substr(start, i - start));
+	}
+	return re;
+}
+
+uint64_t matchName(const std::string& name, const caps_name* names) {
+	for (auto n = names; n->name; n++) {
+		if (name == n->name) return n->cap;
+	}
+	return 0;
+}
+
+/**
+ * @brief Parse the output of -filters, -protocols, -decoders or -buildconf
+ * @param output Output of ffplay
+ * @param names Names to find
+ * @param column The column of name in a table line, -1 means the line only contains a name
+ * @return capabilities
+*/
+uint64_t parseCaps(const std::string& output, const caps_name* names, int column) {
+	uint64_t caps = 0;
+	size_t start = 0;
+	while (start < output.length()) {
+		auto end = output.find('\n', start);
+		if (end == std::string::npos) end = output.length();
+		auto tokens = splitTokens(output.substr(start, end - start));
+		start = end + 1;
+		if (column < 0) {
+			if (tokens.size() == 1) caps |= matchName(tokens.front(), names);
+		} else if (tokens.size() > (size_t)column + 1) {
+			auto t = tokens.begin();
+			std::advance(t, column);
+			caps |= matchName(*t, names);
+		}
+	}
+	return caps;
+}
+
+bool ffcaps::probe(std::string path, int timeout, uint64_t& caps) {
+	const char* queries[] = { "-filters", "-protocols", "-decoders", "-buildconf" };
+	std::string outputs[4];
+	int results[4];
+	std::thread threads[4];
+	for (int i = 0; i < 4; i++) {
+		auto query = queries[i];
+		threads[i] = std::thread([&path, &outputs, &results, timeout, query, i]() {
+			results[i] = fileop::run({ path, "-hide_banner", query }, timeout, &outputs[i]);
+		});
+	}
+	for (int i = 0; i < 4; i++) threads[i].join();
+	/* -filters is needed to play anything with filters. Old builds may lack -buildconf. */
+	if (results[0]) return false;
+	uint64_t re = PROBED;
+	re |= parseCaps(outputs[0], filter_names, 1);
+	if (!results[1]) re |= parseCaps(outputs[1], protocol_names, -1);
+	if (!results[2]) re |= parseCaps(outputs[2], decoder_names, 1);
+	if (!results[3]) {
+		re |= parseCaps(outputs[3], build_names, -1);
+		if (outputs[3].find("--disable-iconv") == std::string::npos) re |= BUILD_ICONV;
+	}
+	caps = re;
+	return true;
+}
+
+std::string ffcaps::toString(uint64_t caps) {
+	if (!(caps & PROBED)) return "unknown";
+	const caps_name* tables[] = { filter_names, protocol_names, decoder_names, build_names };
+	const char* prefixes[] = { "filter:", "protocol:", "decoder:", "" };
+	std::string re;
+	for (int i = 0; i < 4; i++) {
+		for (auto n = tables[i]; n->name; n++) {
+			if (!(caps & n->cap)) continue;
+			if (!re.empty()) re += ' ';
+			re += prefixes[i];
+			re += n->name;
+		}
+	}
+	if (caps & BUILD_ICONV) re += re.empty() ? "iconv" : " iconv";
+	return re;
+}
@@ -0,0 +1,44 @@
+#ifndef _ST_FFCAPS_H
+#define _ST_FFCAPS_H
+
+#include <stdint.h>
+#include <string>
+
+namespace ffcaps {
+	/**
+	 * @brief Capabilities of a ffplay build
+	*/
+	typedef enum capability : uint64_t {
+		FILTER_SUBTITLES = 1ULL << 0,
+		FILTER_ASS = 1ULL << 1,
+		FILTER_SCALE = 1ULL << 2,
+		PROTOCOL_FILE = 1ULL << 16,
+		PROTOCOL_CACHE = 1ULL << 17,
+		DECODER_ASS = 1ULL << 32,
+		DECODER_SSA = 1ULL << 33,
+		DECODER_SUBRIP = 1ULL << 34,
+		DECODER_WEBVTT = 1ULL << 35,
+		DECODER_PGSSUB = 1ULL << 36,
+		BUILD_LIBASS = 1ULL << 48,
+		BUILD_FONTCONFIG = 1ULL << 49,
+		BUILD_ICONV = 1ULL << 50,
+		/// Set if the capabilities are probed. Otherwise nothing is known about the ffplay.
+		PROBED = 1ULL << 63,
+	} capability;
+	/**
+	 * @brief Probe the capabilities of ffplay by running -filters, -protocols, -decoders and -buildconf
+	 * @param path The path of ffplay
+	 * @param timeout Timeout of every query in milliseconds, negative means no timeout
+	 * @param caps Result
+	 * @return true if ffplay works
+	*/
+	bool probe(std::string path, int timeout, uint64_t& caps);
+	/**
+	 * @brief Convert capabilities to a readable string
+	 * @param caps Capabilities
+	 * @return the string
+	*/
+	std::string toString(uint64_t caps);
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "filelist.h"
+#include "pathview.h"
+
+bool filelist::push_back(std::string_view path) {
+	return push_back(std::string_view(), path);
+}
+
+bool filelist::push_back(std::string_view dir, std::string_view name) {
+	auto offset = buffer.size();
+	if (offset + dir.length() + name.length() >= UINT32_MAX) return false;
+	buffer.append(dir);
+	buffer.append(name);
+	buffer.push_back(0);
+	addRecord(offset);
+	return true;
+}
+
+void filelist::addRecord(size_t offset) {
+	record r;
+	r.offset = (uint32_t)offset;
+	r.length = (uint32_t)(buffer.size() - offset - 1);
+	pathview p(std::string_view(buffer.data() + offset, r.length));
+	r.name = (uint32_t)p.namePosition();
+	r.ext = (uint32_t)p.extPosition();
+	items.push_back(r);
+}
+
+void filelist::reserve(size_t count, size_t bytes) {
+	items.reserve(count);
+	buffer.reserve(bytes + count);
+}
+
+void filelist::clear() {
+	buffer.clear();
+	items.clear();
+}
+
+std::string_view filelist::name(size_t i) const {
+	auto& r = items[i];
+	return std::string_view(buffer.data() + r.offset + r.name, r.length - r.name);
+}
+
+std::string_view filelist::ext(size_t i) const {
+	auto& r = items[i];
+	return std::string_view(buffer.data() + r.offset + r.ext, r.length - r.ext);
+}
+
+bool filelist::append(const filelist& other) {
+	auto base = buffer.size();
+	if (base + other.buffer.size() >= UINT32_MAX) return false;
+	buffer.append(other.buffer);
+	items.reserve(items.size() + other.items.size());
+	for (auto i = other.items.begin(); i != other.items.end(); ++i) {
+		record r = *i;
+		r.offset += (uint32_t)base;
+		items.push_back(r);
+	}
+	return true;
+}
+
+void filelist::filterByExt(const std::vector<std::string_view>& exts, filelist& result, bool filter_no_ext) const {
+	result.clear();
+	for (size_t i = 0; i < items.size(); i++) {
+		auto ex = ext(i);
+		bool found = false;
+		if (!ex.empty()) {
+			ex.remove_prefix(1);
+			for (auto j = exts.begin(); j != exts.end(); ++j) {
+				if (ex == *j) {
+					found = true;
+					break;
+				}
+			}
+		} else {
+			if (!filter_no_ext) found = true;
+		}
+		if (found) {
+			auto& r = items[i];
+			auto offset = result.buffer.size();
+			result.buffer.append(buffer.data() + r.offset, r.length + 1);
+			record n = r;
+			n.offset = (uint32_t)offset;
+			result.items.push_back(n);
+		}
+	}
+}
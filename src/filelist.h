@@ -0,0 +1,123 @@
+#ifndef _ST_FILELIST_H
+#define _ST_FILELIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A list of file paths stored in one contiguous buffer.
+ * Each path is kept with the offsets of its file name and ext, so iterating and filtering
+ * never allocate. Views returned are valid until the list is modified.
+*/
+class filelist {
+public:
+	typedef struct record {
+		/// Offset of the path in buffer, the path is always followed by a NUL character
+		uint32_t offset;
+		uint32_t length;
+		/// Offset of the file name in the path
+		uint32_t name;
+		/// Offset of the ext (contains `.`) in the path, equals to length if no ext
+		uint32_t ext;
+	} record;
+	class iterator {
+	public:
+		iterator(const filelist* l, size_t i) : list(l), index(i) {}
+		std::string_view operator*() const {
+			return (*list)[index];
+		}
+		iterator& operator++() {
+			index++;
+			return *this;
+		}
+		bool operator==(const iterator& o) const {
+			return index == o.index;
+		}
+		bool operator!=(const iterator& o) const {
+			return index != o.index;
+		}
+		/**
+		 * @brief Get the position in list
+		*/
+		size_t position() const {
+			return index;
+		}
+	private:
+		const filelist* list;
+		size_t index;
+	};
+	/**
+	 * @brief Add a path
+	 * @param path The path
+	 * @return false if the list is too big
+	*/
+	bool push_back(std::string_view path);
+	/**
+	 * @brief Add a path joined from a directory and a file name without building a temporary string
+	 * @param dir The directory, should end with path separator
+	 * @param name The file name
+	 * @return false if the list is too big
+	*/
+	bool push_back(std::string_view dir, std::string_view name);
+	/**
+	 * @brief Reserve memory
+	 * @param count The count of paths
+	 * @param bytes The total length of paths
+	*/
+	void reserve(size_t count, size_t bytes);
+	void clear();
+	size_t size() const {
+		return items.size();
+	}
+	bool empty() const {
+		return items.empty();
+	}
+	std::string_view operator[](size_t i) const {
+		auto& r = items[i];
+		return std::string_view(buffer.data() + r.offset, r.length);
+	}
+	/**
+	 * @brief Get a path as a NUL terminated string
+	*/
+	const char* c_str(size_t i) const {
+		return buffer.data() + items[i].offset;
+	}
+	/**
+	 * @brief Get the file name of a path
+	*/
+	std::string_view name(size_t i) const;
+	/**
+	 * @brief Get the ext of a path (contains `.`), same as fileop::splitext
+	*/
+	std::string_view ext(size_t i) const;
+	iterator begin() const {
+		return iterator(this, 0);
+	}
+	iterator end() const {
+		return iterator(this, items.size());
+	}
+	/**
+	 * @brief Append paths of another list
+	 * @return false if the list is too big
+	*/
+	bool append(const filelist& other);
+	/**
+	 * @brief Keep paths which have one of exts
+	 * @param exts Ext list (without `.`), compared case sensitively
+	 * @param result Filtered list, cleared first
+	 * @param filter_no_ext Whether to filter paths which don't have a ext
+	*/
+	void filterByExt(const std::vector<std::string_view>& exts, filelist& result, bool filter_no_ext = true) const;
+private:
+	std::string buffer;
+	std::vector<record> items;
+	/**
+	 * @brief Add a record for the path at the end of buffer
+	*/
+	void addRecord(size_t offset);
+};
+
+#endif
@@ -7,21 +7,41 @@
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #include <windows.h>
 #include <io.h>
+#include <direct.h>
+#include <process.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/utime.h>
+#include <time.h>
 #else
 #include <wchar.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
+#include <errno.h>
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 
-#ifdef HAVE_READDIR64
-#define readdir readdir64
-#endif
+extern char** environ;
 
 #endif
+#include <atomic>
 #include "util.h"
 #include "chariconv.h"
+#include "dirindex.h"
+#include "dirscan.h"
+#include "fsbackend.h"
+#include "pathview.h"
 #include "console.h"
+#include "trace.h"
+
+/// Its modification time is when the cache is trimmed last time
+#define CACHE_TRIM_STAMP "trim.stamp"
 
 #ifndef max
 #define max(a,b) (((a) > (b)) ? (a) : (b))
@@ -86,7 +106,61 @@ int system_internal(wchar_t* command) {
 	return _wsystem(command);
 }
 
-bool win32FindFile_internal(wchar_t* fname, std::list<std::string>& fl) {
+bool stat_internal(wchar_t* fn, struct _stat64* st) {
+	return !_wstat64(fn, st);
+}
+
+bool mkdir_internal(wchar_t* fn) {
+	return !_wmkdir(fn) || errno == EEXIST;
+}
+
+bool remove_internal(wchar_t* fn) {
+	return !_wremove(fn) || !_wrmdir(fn);
+}
+
+bool touch_internal(wchar_t* fn) {
+	return !_wutime(fn, nullptr);
+}
+
+bool replace_internal(wchar_t* src, const char* dst, UINT codePage) {
+	DWORD opt = util::getMultiByteToWideCharOptions(MB_ERR_INVALID_CHARS, codePage);
+	int wlen = MultiByteToWideChar(codePage, opt, dst, -1, NULL, 0);
+	if (!wlen) return false;
+	auto fn = (wchar_t*)malloc(sizeof(wchar_t) * wlen);
+	if (!fn) return false;
+	bool re = false;
+	if (MultiByteToWideChar(codePage, opt, dst, -1, fn, wlen)) {
+		re = MoveFileExW(src, fn, MOVEFILE_REPLACE_EXISTING);
+	}
+	free(fn);
+	return re;
+}
+
+bool link_internal(wchar_t* src, const char* dst, UINT codePage) {
+	DWORD opt = util::getMultiByteToWideCharOptions(MB_ERR_INVALID_CHARS, codePage);
+	int wlen = MultiByteToWideChar(codePage, opt, dst, -1, NULL, 0);
+	if (!wlen) return false;
+	auto fn = (wchar_t*)malloc(sizeof(wchar_t) * wlen);
+	if (!fn) return false;
+	bool re = false;
+	if (MultiByteToWideChar(codePage, opt, dst, -1, fn, wlen)) {
+		re = CreateHardLinkW(fn, src, NULL) || CopyFileW(src, fn, TRUE);
+	}
+	free(fn);
+	return re;
+}
+
+bool realpath_internal(wchar_t* fn, std::string* result) {
+	auto full = _wfullpath(nullptr, fn, 0);
+	if (!full) return false;
+	std::string re;
+	bool ok = chariconv::WStringToUTF8(full, re);
+	free(full);
+	if (ok) *result = re;
+	return ok;
+}
+
+bool win32FindFile_internal(wchar_t* fname, filelist& fl) {
 	WIN32_FIND_DATAW data;
 	HANDLE h = FindFirstFileW(fname, &data);
 	if (h == INVALID_HANDLE_VALUE) {
@@ -177,6 +251,8 @@ bool fileop::exists(const char* fname, bool use_wchar) {
 
 bool fileop::exists(std::string fname, bool use_wchar) {
 	if (fname.empty()) return false;
+	auto& b = backend();
+	if (!b.native()) return b.exists(fname);
 	return exists(fname.c_str(), use_wchar);
 }
 
@@ -203,22 +279,11 @@ bool fileop::close(FILE* f) {
 	return !fclose(f);
 }
 
-bool fileop::splitext(const std::string fname, std::string* name, std::string* ext) {
+bool fileop::splitext(std::string_view fname, std::string* name, std::string* ext) {
 	if (fname.empty() || (!name && !ext)) return false;
-	auto l1 = fname.find_last_of('.');
-	auto l2 = fname.find_last_of('/');
-	auto l3 = fname.find_last_of('\\');
-	if ((l2 != -1 && l2 > l1) || (l3 != -1 && l3 > l1)) l1 = -1;
-	if (name) {
-		if (l1 == -1) *name = fname;
-		else if (!l1) *name = "";
-		else *name = fname.substr(0, l1);
-	}
-	if (ext) {
-		if (l1 == -1) *ext = "";
-		else if (!l1) *ext = fname;
-		else *ext = fname.substr(l1, fname.length() - l1);
-	}
+	pathview p(fname);
+	if (name) *name = p.stem();
+	if (ext) *ext = p.ext();
 	return true;
 }
 
@@ -392,7 +457,610 @@ int fileop::system(const char* command) {
 	return ::system(command);
 }
 
+#if defined(_WIN32) && !defined(__CYGWIN__)
+/**
+ * @brief Quote argument by the rules of CommandLineToArgvW
+ * @param arg Argument
+ * @return Quoted argument
+*/
+std::string quoteArgument(const std::string& arg) {
+	if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) return arg;
+	std::string re = "\"";
+	size_t backslashes = 0;
+	for (auto i = arg.begin(); i != arg.end(); ++i) {
+		if (*i == '\\') {
+			backslashes++;
+			continue;
+		}
+		if (*i == '"') re.append(backslashes * 2 + 1, '\\');
+		else re.append(backslashes, '\\');
+		backslashes = 0;
+		re += *i;
+	}
+	re.append(backslashes * 2, '\\');
+	re += '"';
+	return re;
+}
+#endif
+
+int fileop::spawn(const std::list<std::string>& args, const std::function<void()>& started) {
+	if (args.empty()) return -1;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	std::string command;
+	for (auto i = args.begin(); i != args.end(); ++i) {
+		if (!command.empty()) command += ' ';
+		command += quoteArgument(*i);
+	}
+	/* cmd.exe strips the first and last quote when the command starts with a quote. */
+	if (command[0] == '"') command = "\"" + command + "\"";
+	if (started) started();
+	return system(command.c_str());
+#else
+	auto argv = (char**)malloc(sizeof(char*) * (args.size() + 1));
+	if (!argv) {
+		console::warn("Can not allocate memory, needed size: %zi.", sizeof(char*) * (args.size() + 1));
+		return -1;
+	}
+	size_t argc = 0;
+	for (auto i = args.begin(); i != args.end(); ++i) {
+		argv[argc++] = (char*)i->c_str();
+	}
+	argv[argc] = nullptr;
+	/* Same as system(), ignore SIGINT and SIGQUIT while waiting child and let child use default handlers. */
+	struct sigaction ign, oint, oquit;
+	memset(&ign, 0, sizeof(ign));
+	ign.sa_handler = SIG_IGN;
+	sigemptyset(&ign.sa_mask);
+	sigaction(SIGINT, &ign, &oint);
+	sigaction(SIGQUIT, &ign, &oquit);
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	sigset_t def;
+	sigemptyset(&def);
+	if (oint.sa_handler != SIG_IGN) sigaddset(&def, SIGINT);
+	if (oquit.sa_handler != SIG_IGN) sigaddset(&def, SIGQUIT);
+	posix_spawnattr_setsigdefault(&attr, &def);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+	pid_t pid;
+	int re = posix_spawnp(&pid, argv[0], nullptr, &attr, argv, environ);
+	posix_spawnattr_destroy(&attr);
+	free(argv);
+	int status = -1;
+	if (re) {
+		console::verbose("posix_spawnp(%s) failed: %s", args.front().c_str(), strerror(re));
+	} else {
+		if (started) started();
+		while (waitpid(pid, &status, 0) == -1) {
+			if (errno != EINTR) {
+				status = -1;
+				break;
+			}
+		}
+	}
+	sigaction(SIGINT, &oint, nullptr);
+	sigaction(SIGQUIT, &oquit, nullptr);
+	if (re || status == -1) return -1;
+	if (WIFEXITED(status)) return WEXITSTATUS(status);
+	if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+	return -1;
+#endif
+}
+
+#if !defined(_WIN32) || defined(__CYGWIN__)
+/**
+ * @brief Get milliseconds from a monotonic clock
+*/
+long long monotonicMs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+#endif
+
+int fileop::run(const std::list<std::string>& args, int timeout, std::string* output) {
+	if (args.empty()) return -1;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	std::string command;
+	for (auto i = args.begin(); i != args.end(); ++i) {
+		if (!command.empty()) command += ' ';
+		command += quoteArgument(*i);
+	}
+	command += " 2>NUL";
+	if (command[0] == '"') command = "\"" + command + "\"";
+	auto f = popen(command.c_str(), "rb");
+	if (!f) return -1;
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		if (output) output->append(buf, n);
+	}
+	return pclose(f);
+#else
+	auto argv = (char**)malloc(sizeof(char*) * (args.size() + 1));
+	if (!argv) {
+		console::warn("Can not allocate memory, needed size: %zi.", sizeof(char*) * (args.size() + 1));
+		return -1;
+	}
+	size_t argc = 0;
+	for (auto i = args.begin(); i != args.end(); ++i) {
+		argv[argc++] = (char*)i->c_str();
+	}
+	argv[argc] = nullptr;
+	int fds[2];
+	if (pipe2(fds, O_CLOEXEC)) {
+		free(argv);
+		return -1;
+	}
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], 1);
+	posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+	pid_t pid;
+	int re = posix_spawnp(&pid, argv[0], &actions, nullptr, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	free(argv);
+	::close(fds[1]);
+	if (re) {
+		console::verbose("posix_spawnp(%s) failed: %s", args.front().c_str(), strerror(re));
+		::close(fds[0]);
+		return -1;
+	}
+	auto deadline = timeout < 0 ? -1 : monotonicMs() + timeout;
+	bool timedout = false;
+	char buf[4096];
+	while (true) {
+		int wait = -1;
+		if (deadline >= 0) {
+			auto left = deadline - monotonicMs();
+			if (left <= 0) {
+				timedout = true;
+				break;
+			}
+			wait = (int)left;
+		}
+		struct pollfd p = { fds[0], POLLIN, 0 };
+		int r = poll(&p, 1, wait);
+		if (r < 0 && errno == EINTR) continue;
+		if (r <= 0) {
+			timedout = r == 0;
+			break;
+		}
+		auto n = read(fds[0], buf, sizeof(buf));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		if (output) output->append(buf, n);
+	}
+	::close(fds[0]);
+	int status = 0;
+	/* The program may close standard output before it exits. */
+	int delay = 1;
+	while (!timedout) {
+		auto r = waitpid(pid, &status, WNOHANG);
+		if (r == pid) break;
+		if (r < 0 && errno != EINTR) return -1;
+		if (deadline >= 0 && monotonicMs() >= deadline) {
+			timedout = true;
+			break;
+		}
+		struct timespec ts = { 0, delay * 1000000L };
+		nanosleep(&ts, nullptr);
+		if (delay < 16) delay *= 2;
+	}
+	if (timedout) {
+		console::verbose("%s does not exit in %i ms, kill it.", args.front().c_str(), timeout);
+		kill(pid, SIGKILL);
+		while (waitpid(pid, &status, 0) == -1 && errno == EINTR);
+		return -1;
+	}
+	if (WIFEXITED(status)) return WEXITSTATUS(status);
+	return -1;
+#endif
+}
+
+int fileop::exec(const std::list<std::string>& args) {
+	if (args.empty()) return -1;
+	fflush(stdout);
+	fflush(stderr);
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	console::verbose("exec is not supported on Windows, wait ffplay exit instead.");
+	exit(spawn(args));
+#else
+	auto argv = (char**)malloc(sizeof(char*) * (args.size() + 1));
+	if (!argv) {
+		console::warn("Can not allocate memory, needed size: %zi.", sizeof(char*) * (args.size() + 1));
+		return -1;
+	}
+	size_t argc = 0;
+	for (auto i = args.begin(); i != args.end(); ++i) {
+		argv[argc++] = (char*)i->c_str();
+	}
+	argv[argc] = nullptr;
+	execvp(argv[0], argv);
+	console::verbose("execvp(%s) failed: %s", args.front().c_str(), strerror(errno));
+	free(argv);
+	return -1;
+#endif
+}
+
+static nativebackend native_backend;
+static std::atomic<fsbackend*> current_backend(nullptr);
+
+fsbackend& fileop::backend() {
+	auto b = current_backend.load(std::memory_order_acquire);
+	return b ? *b : native_backend;
+}
+
+void fileop::setBackend(fsbackend* b) {
+	current_backend.store(b, std::memory_order_release);
+}
+
+bool nativebackend::exists(const std::string& path) {
+	return fileop::exists(path.c_str());
+}
+
+bool fileop::getFileId(std::string path, fileid& id) {
+	if (path.empty()) return false;
+	return backend().stat(path, id);
+}
+
+bool nativebackend::stat(const std::string& path, fileop::fileid& id) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	struct _stat64 st;
+	UINT cp[] = { CP_UTF8, CP_OEMCP, CP_ACP };
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (fileop_internal<bool, struct _stat64*>(path.c_str(), cp[i], &stat_internal, false, &st)) break;
+	}
+	if (i == 3) return false;
+	id.dev = st.st_dev;
+	id.ino = st.st_ino;
+	id.size = st.st_size;
+	id.mtime = (long long)st.st_mtime * 1000000000LL;
+	id.ctime = (long long)st.st_ctime * 1000000000LL;
+#else
+	struct stat st;
+	if (::stat(path.c_str(), &st)) return false;
+	id.dev = st.st_dev;
+	id.ino = st.st_ino;
+	id.size = st.st_size;
+	id.mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+	id.ctime = (long long)st.st_ctim.tv_sec * 1000000000LL + st.st_ctim.tv_nsec;
+#endif
+	return true;
+}
+
+std::string fileop::realpath(std::string path) {
+	if (path.empty()) return "";
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	std::string re;
+	UINT cp[] = { CP_UTF8, CP_OEMCP, CP_ACP };
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (fileop_internal<bool, std::string*>(path.c_str(), cp[i], &realpath_internal, false, &re)) return re;
+	}
+	return "";
+#else
+	auto s = ::realpath(path.c_str(), nullptr);
+	if (!s) return "";
+	std::string re(s);
+	free(s);
+	return re;
+#endif
+}
+
+/**
+ * @brief Check whether path is an executable regular file
+ * @param path The path
+ * @return true if is executable
+*/
+bool isExecutable(const std::string& path) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	return fileop::exists(path);
+#else
+	struct stat st;
+	if (::stat(path.c_str(), &st) || !S_ISREG(st.st_mode)) return false;
+	return !faccessat(AT_FDCWD, path.c_str(), X_OK, AT_EACCESS);
+#endif
+}
+
+std::string fileop::which(std::string name) {
+	if (name.empty()) return "";
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	const char sep = ';';
+	std::list<std::string> exts = { "" };
+	if (pathview(name).ext().empty()) {
+		auto pathext = getenv("PATHEXT");
+		std::string pe = pathext ? pathext : ".COM;.EXE;.BAT;.CMD";
+		size_t start = 0;
+		while (start <= pe.length()) {
+			auto end = pe.find(sep, start);
+			if (end == std::string::npos) end = pe.length();
+			if (end > start) exts.push_back(pe.substr(start, end - start));
+			start = end + 1;
+		}
+	}
+#else
+	const char sep = ':';
+	std::list<std::string> exts = { "" };
+#endif
+	if (name.find_first_of("/\\") != std::string::npos) {
+		for (auto e = exts.begin(); e != exts.end(); ++e) {
+			if (isExecutable(name + *e)) return realpath(name + *e);
+		}
+		return "";
+	}
+	auto env = getenv("PATH");
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	std::string path = env ? ".;" + std::string(env) : ".";
+#else
+	std::string path = env ? env : "/usr/local/bin:/usr/bin:/bin";
+#endif
+	size_t start = 0;
+	std::string candidate;
+	while (start <= path.length()) {
+		auto end = path.find(sep, start);
+		if (end == std::string::npos) end = path.length();
+		auto dir = end > start ? std::string_view(path).substr(start, end - start) : std::string_view(".");
+		start = end + 1;
+		for (auto e = exts.begin(); e != exts.end(); ++e) {
+			candidate.clear();
+			pathview::join(candidate, dir, name);
+			candidate += *e;
+			if (isExecutable(candidate)) {
+				auto re = realpath(candidate);
+				if (!re.empty()) return re;
+			}
+		}
+	}
+	return "";
+}
+
+bool fileop::mkdirs(std::string path) {
+	if (path.empty()) return false;
+	if (exists(path)) return true;
+	auto dir = pathview(path).dir();
+	if (!dir.empty()) {
+		if (dir.length() > 1) dir.remove_suffix(1);
+		auto parent = pathview::native(dir);
+		if (parent != path && !mkdirs(parent)) return false;
+	}
+	return backend().mkdir(path);
+}
+
+bool nativebackend::mkdir(const std::string& path) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	UINT cp[] = { CP_UTF8, CP_OEMCP, CP_ACP };
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (fileop_internal(path.c_str(), cp[i], &mkdir_internal, false)) return true;
+	}
+	return false;
+#else
+	return !::mkdir(path.c_str(), 0755) || errno == EEXIST;
+#endif
+}
+
+bool fileop::replace(std::string src, std::string dest) {
+	if (src.empty() || dest.empty()) return false;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	UINT cp[] = { CP_UTF8, CP_OEMCP, CP_ACP };
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (fileop_internal<bool, const char*, UINT>(src.c_str(), cp[i], &replace_internal, false, dest.c_str(), cp[i])) return true;
+	}
+	return false;
+#else
+	return !::rename(src.c_str(), dest.c_str());
+#endif
+}
+
+bool fileop::link(std::string src, std::string dest) {
+	if (src.empty() || dest.empty()) return false;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	UINT cp[] = { CP_UTF8, CP_OEMCP, CP_ACP };
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (fileop_internal<bool, const char*, UINT>(src.c_str(), cp[i], &link_internal, false, dest.c_str(), cp[i])) return true;
+	}
+	return false;
+#else
+	return !::symlink(src.c_str(), dest.c_str());
+#endif
+}
+
+bool fileop::removeAll(std::string path) {
+	if (path.empty()) return false;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	UINT cp[] = { CP_UTF8, CP_OEMCP, CP_ACP };
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (fileop_internal(path.c_str(), cp[i], &remove_internal, false)) return true;
+	}
+#else
+	if (!::remove(path.c_str())) return true;
+#endif
+	/* Not empty directory */
+	dirscan scanner;
+	if (!scanner.scan(path)) return false;
+	auto& entries = scanner.entries();
+	auto& dir = scanner.directory();
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		removeAll(combilePath(dir, i->name));
+	}
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	for (i = 0; i < 3; i++) {
+		if (fileop_internal(path.c_str(), cp[i], &remove_internal, false)) return true;
+	}
+	return false;
+#else
+	return !::remove(path.c_str());
+#endif
+}
+
+bool fileop::touch(std::string path) {
+	if (path.empty()) return false;
+	return backend().touch(path);
+}
+
+bool nativebackend::touch(const std::string& path) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	UINT cp[] = { CP_UTF8, CP_OEMCP, CP_ACP };
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (fileop_internal(path.c_str(), cp[i], &touch_internal, false)) return true;
+	}
+	return false;
+#else
+	return !utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+#endif
+}
+
+bool fileop::readFile(std::string path, std::string& data, size_t maxSize) {
+	return backend().readFile(path, data, maxSize);
+}
+
+bool nativebackend::readFile(const std::string& path, std::string& data, size_t maxSize) {
+	using namespace fileop;
+	auto f = open(path.c_str(), "rb");
+	if (!f) return false;
+	size_t size;
+	if (!filesize(f, size) || size > maxSize) {
+		close(f);
+		return false;
+	}
+	data.resize(size);
+	if (size && fread(&data[0], 1, size, f) != size) {
+		close(f);
+		return false;
+	}
+	close(f);
+	return true;
+}
+
+/// Make temporary file names unique between threads
+static std::atomic<int> tmpcount(0);
+
+bool fileop::writeFile(std::string path, const char* data, size_t len) {
+	if (path.empty() || (!data && len)) return false;
+	return backend().writeFile(path, data, len);
+}
+
+bool nativebackend::writeFile(const std::string& path, const char* data, size_t len) {
+	using namespace fileop;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	auto tmp = path + "." + util::itoa(_getpid()) + "." + util::itoa(tmpcount++) + ".tmp";
+#else
+	auto tmp = path + "." + util::itoa(getpid()) + "." + util::itoa(tmpcount++) + ".tmp";
+#endif
+	auto f = open(tmp.c_str(), "wb");
+	if (!f) {
+		console::verbose("Can not open file \"%s\".", tmp.c_str());
+		return false;
+	}
+	bool ok = !len || fwrite(data, 1, len, f) == len;
+	ok = close(f) && ok;
+	if (ok) ok = replace(tmp, path);
+	if (!ok) {
+		console::verbose("Can not write file \"%s\".", path.c_str());
+		remove(tmp.c_str());
+	}
+	return ok;
+}
+
+std::string fileop::getCacheDir() {
+	std::string base;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	auto local = _wgetenv(L"LOCALAPPDATA");
+	if (!local || !chariconv::WStringToUTF8(local, base)) return "";
+#else
+	auto xdg = getenv("XDG_CACHE_HOME");
+	if (xdg && *xdg == '/') {
+		base = xdg;
+	} else {
+		auto home = getenv("HOME");
+		if (!home || !*home) return "";
+		base = combilePath(home, ".cache");
+	}
+#endif
+	auto dir = combilePath(base, "ffplay-starter");
+	if (!mkdirs(dir)) {
+		console::verbose("Can not create cache directory: %s", dir.c_str());
+		return "";
+	}
+	return dir;
+}
+
+/**
+ * @brief Get when a cache entry is used last time. A directory counts as used when any file directly in it is touched.
+ * @param path The entry
+ * @return modification time in nanoseconds, 0 if failed
+*/
+static long long getLastUse(const std::string& path) {
+	fileop::fileid id;
+	if (!fileop::getFileId(path, id)) return 0;
+	long long last = id.mtime;
+	dirscan scanner;
+	if (!scanner.scan(path)) return last;
+	auto& entries = scanner.entries();
+	auto& dir = scanner.directory();
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		if (fileop::getFileId(fileop::combilePath(dir, i->name), id) && id.mtime > last) last = id.mtime;
+	}
+	return last;
+}
+
+/**
+ * @brief Remove entries of a cache directory which are older than limit
+ * @param dir The directory
+ * @param limit Modification time in nanoseconds
+ * @param skip The name of an entry which is kept
+ * @return the count of removed entries
+*/
+static size_t trimCacheDir(const std::string& dir, long long limit, std::string_view skip = std::string_view()) {
+	dirscan scanner;
+	if (!scanner.scan(dir)) return 0;
+	size_t count = 0;
+	auto& entries = scanner.entries();
+	auto& base = scanner.directory();
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		if (i->name == skip) continue;
+		auto path = fileop::combilePath(base, i->name);
+		auto last = getLastUse(path);
+		if (!last || last >= limit) continue;
+		if (fileop::removeAll(path)) {
+			console::verbose("Remove unused cache: %s", path.c_str());
+			count++;
+		}
+	}
+	return count;
+}
+
+size_t fileop::trimCache(int days) {
+	if (days <= 0 || !backend().native()) return 0;
+	auto cache = getCacheDir();
+	if (cache.empty()) return 0;
+	const long long day = 86400LL * 1000000000LL;
+	long long now = (long long)time(nullptr) * 1000000000LL;
+	auto stamp = combilePath(cache, CACHE_TRIM_STAMP);
+	fileid id;
+	if (getFileId(stamp, id) && now - id.mtime < day) return 0;
+	trace::scope t("trimCache");
+	/* Written first, so other processes started at the same time skip it. */
+	if (!writeFile(stamp, "", 0)) return 0;
+	long long limit = now - days * day;
+	auto fonts = combilePath(cache, "fonts");
+	size_t count = trimCacheDir(fonts, limit, "embedded");
+	count += trimCacheDir(combilePath(fonts, "embedded"), limit);
+	count += trimCacheDir(combilePath(cache, "dirindex"), limit);
+	count += trimCacheDir(combilePath(cache, "staging"), limit);
+	count += trimCacheDir(combilePath(cache, "charset"), limit);
+	if (count) console::verbose("Removed %zu unused cache entries.", count);
+	return count;
+}
+
 std::string fileop::getProgramLocation() {
+	trace::scope t("getProgramLocation");
 #if defined(_WIN32) && !defined(__CYGWIN__)
 	auto fn = (wchar_t*)malloc(sizeof(wchar_t) * DefaultMaxFileNameSize);
 	if (!fn) {
@@ -420,7 +1088,7 @@ std::string fileop::getProgramLocation() {
 	}
 	auto len = readlink("/proc/self/exe", fn, DefaultMaxFileNameSize);
 	if (len > 0) {
-		std::string temp(fn);
+		std::string temp(fn, len);
 		free(fn);
 		return temp;
 	}
@@ -430,12 +1098,12 @@ std::string fileop::getProgramLocation() {
 }
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
-bool fileop::win32FindFile(const char* fname, std::list<std::string>& fl) {
+bool fileop::win32FindFile(const char* fname, filelist& fl) {
 	if (!fname) return false;
 	UINT cp[] = { CP_UTF8, CP_OEMCP, CP_ACP };
 	int i;
 	for (i = 0; i < 3; i++) {
-		auto re = fileop_internal<bool, std::list<std::string>&>(fname, cp[i], &win32FindFile_internal, false, fl);
+		auto re = fileop_internal<bool, filelist&>(fname, cp[i], &win32FindFile_internal, false, fl);
 		if (re) return re;
 	}
 	WIN32_FIND_DATAA data;
@@ -451,150 +1119,124 @@ bool fileop::win32FindFile(const char* fname, std::list<std::string>& fl) {
 }
 #endif
 
-std::string fileop::combilePath(std::string base, std::string name) {
-	auto len = base.length();
-	auto s = base;
-	if (base[len - 1] != '\\' && base[len - 1] != '/') s += '/';
-	s += name;
-#if defined(_WIN32) && !defined(__CYGWIN__)
-	util::strreplace(s, "/", "\\");
-#else
-	util::strreplace(s, "\\", "/");
-#endif
-	return s;
+std::string fileop::combilePath(std::string_view base, std::string_view name) {
+	return pathview::join(base, name);
 }
 
-bool fileop::split(std::string path, std::string* dir, std::string* name) {
+bool fileop::split(std::string_view path, std::string* dir, std::string* name) {
 	if (path.empty() || (!dir && !name)) return false;
-	auto l = path.find_last_of('/');
-	auto l2 = path.find_last_of('\\');
-	auto r = l != -1 && l2 != -1 ? max(l, l2) : l2 != -1 ? l2 : l != -1 ? l : -1;
-	if (dir) {
-		if (r == -1) *dir = "";
-		else *dir = path.substr(0, r + 1);
-#if defined(_WIN32) && !defined(__CYGWIN__)
-		util::strreplace(*dir, "/", "\\");
-#else
-		util::strreplace(*dir, "\\", "/");
-#endif
-	}
-	if (name) {
-		if (r == -1) *name = path;
-		else *name = path.substr(r + 1, path.length() - r - 1);
-#if defined(_WIN32) && !defined(__CYGWIN__)
-		util::strreplace(*name, "/", "\\");
-#else
-		util::strreplace(*name, "\\", "/");
-#endif
-	}
+	pathview p(path);
+	if (dir) *dir = pathview::native(p.dir());
+	if (name) *name = pathview::native(p.name());
 	return true;
 }
 
-bool fileop::addDirectoryToFileNameList(std::string base, std::list<std::string>& fl) {
+bool fileop::addDirectoryToFileNameList(std::string base, filelist& fl) {
 	if (base.empty()) return false;
-	for (auto i = fl.begin(); i != fl.end(); ++i) {
-		*i = combilePath(base, *i);
+	filelist re;
+	re.reserve(fl.size(), fl.size() * (base.length() + 32));
+	std::string s;
+	for (size_t i = 0; i < fl.size(); i++) {
+		s.clear();
+		pathview::join(s, base, fl[i]);
+		re.push_back(s);
 	}
+	fl = std::move(re);
 	return true;
 }
 
-bool fileop::listdir(std::string path, std::list<std::string>& fl, bool fullpath) {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-	auto len = path.length();
-	if (path[len - 1] != '/' && path[len - 1] != '\\') path += "\\";
-	util::strreplace(path, "/", "\\");
-	std::string s = path + "*";
-	if (!win32FindFile(s.c_str(), fl)) {
-		return false;
+bool fileop::listdir(std::string path, filelist& fl, bool fullpath) {
+	dirscan scanner;
+	if (!scanner.scan(path)) return false;
+	auto& entries = scanner.entries();
+	auto& dir = scanner.directory();
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		if (fullpath) fl.push_back(dir, i->name);
+		else fl.push_back(i->name);
 	}
-#else
-	util::strreplace(path, "\\", "/");
-	auto dir = opendir(path.c_str());
-	if (!dir) {
-		console::verbose("opendir(%s) failed.", path.c_str());
-		return false;
-	}
-	auto d = readdir(dir);
-	while (d != nullptr) {
-		if (d->d_name[0] == '.') {
-			d = readdir(dir);
-			continue;
-		}
-		fl.push_back(d->d_name);
-		d = readdir(dir);
-	}
-	closedir(dir);
-#endif
-	if (fullpath) addDirectoryToFileNameList(path, fl);
 	return true;
 }
 
-bool fileop::listrelative(std::string file, std::list<std::string>& fl) {
+/**
+ * @brief Get the directory, the name prefix of relative files and the file name of a file
+ * @return true if OK
+*/
+bool splitRelative(const std::string& file, std::string& path, std::string& prefix, std::string& name) {
 	if (file.empty()) return false;
+	pathview p(file);
+	path = pathview::native(p.dir());
+	name = pathview::native(p.name());
+	prefix = pathview::native(p.nameStem());
+	prefix += '.';
+	return true;
+}
+
+bool fileop::listrelative(std::string file, filelist& fl, bool useIndex) {
+	if (file.empty()) return false;
+	trace::scope t("listrelative", file.c_str());
 	console::verbose("List all relative files for '%s'", file.c_str());
-	std::string base;
-	if (!splitext(file, &base, nullptr)) {
-		console::verbose("Can not split file name by ext: %s", file.c_str());
-		return false;
-	}
-	std::string path;
-	if (!split(file, &path, nullptr)) {
-		console::verbose("Can not split file name: %s", file.c_str());
-		return false;
-	}
-	base += ".";
-#if defined(_WIN32) && !defined(__CYGWIN__)
-	auto t = base + "*";
-	if (win32FindFile(t.c_str(), fl)) {
-		addDirectoryToFileNameList(path, fl);
-		for (auto i = fl.begin(); i != fl.end(); ++i) {
-			auto fn = *i;
-			if (fn == file) {
-				fl.remove(fn);
-				break;
+	std::string path, prefix, name;
+	if (!splitRelative(file, path, prefix, name)) return false;
+	std::vector<dirscan::entry> matched;
+	if (useIndex) {
+		dirindex index;
+		if (index.open(path) && index.find(prefix, matched)) {
+			console::verbose("Use directory index of '%s' (%zu entries).", path.c_str(), index.size());
+			for (auto i = matched.begin(); i != matched.end(); ++i) {
+				if (i->name != name) fl.push_back(index.directory(), i->name);
 			}
+			return true;
+		}
+		/* Directory stamp is taken before scanning, so changes during the scan make the index stale. */
+		fileid id;
+		if (getFileId(path, id)) {
+			dirscan scanner;
+			if (!scanner.scan(path, prefix, true)) {
+				console::verbose("Can not list dir: %s", path.c_str());
+				return false;
+			}
+			/* Only a directory big enough to be indexed is listed again in full. */
+			if (scanner.entries().size() + scanner.skipped() >= DIRINDEX_MIN_ENTRIES && !dirindex::isRacy(id)) {
+				dirscan all;
+				if (all.scan(path) && dirindex::store(all, id)) console::verbose("Build directory index of '%s'.", path.c_str());
+			}
+			auto& entries = scanner.entries();
+			auto& dir = scanner.directory();
+			for (auto i = entries.begin(); i != entries.end(); ++i) {
+				if (i->name != name) fl.push_back(dir, i->name);
+			}
+			return true;
 		}
-		return true;
 	}
-	console::verbose("Failed to use FindFile directly.");
-#endif
-	std::list<std::string> tl;
-	if (!listdir(path, tl)) {
+	/* Only names starting with the stem are kept while scanning, full paths are built for them. */
+	dirscan scanner;
+	if (!scanner.scan(path, prefix)) {
 		console::verbose("Can not list dir: %s", path.c_str());
 		return false;
 	}
-	for (auto i = tl.begin(); i != tl.end(); ++i) {
-		auto fn = *i;
-		if (fn.find(base, 0) == 0 && fn != file) {
-			fl.push_back(fn);
-		}
+	auto& entries = scanner.entries();
+	auto& dir = scanner.directory();
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		if (i->name != name) fl.push_back(dir, i->name);
 	}
 	return true;
 }
 
-bool fileop::filterFileListByExt(std::list<std::string> fl, std::list<std::string> exts, std::list<std::string>& result, bool filter_no_ext) {
-	if (fl.empty() || exts.empty()) return false;
-	result.clear();
-	for (auto i = fl.begin(); i != fl.end(); ++i) {
-		auto fn = *i;
-		std::string ext;
-		if (!splitext(fn, nullptr, &ext)) {
-			console::verbose("Can not split file name by ext: %s", fn.c_str());
-			return false;
-		}
-		bool found = false;
-		if (!ext.empty()) {
-			for (auto j = exts.begin(); j != exts.end(); ++j) {
-				auto ex = "." + *j;
-				if (ex == ext) {
-					found = true;
-					break;
-				}
-			}
-		} else {
-			if (!filter_no_ext) found = true;
-		}
-		if (found) result.push_back(fn);
+bool fileop::listrelativeCached(std::string file, filelist& fl) {
+	if (file.empty()) return false;
+	std::string path, prefix, name;
+	if (!splitRelative(file, path, prefix, name)) return false;
+	dirindex index;
+	std::vector<dirscan::entry> matched;
+	if (!index.open(path, false) || !index.find(prefix, matched)) return false;
+	for (auto i = matched.begin(); i != matched.end(); ++i) {
+		if (i->name != name) fl.push_back(index.directory(), i->name);
 	}
 	return true;
 }
+
+bool fileop::filterFileListByExt(const filelist& fl, const std::vector<std::string_view>& exts, filelist& result, bool filter_no_ext) {
+	if (fl.empty() || exts.empty()) return false;
+	fl.filterByExt(exts, result, filter_no_ext);
+	return true;
+}
@@ -3,10 +3,37 @@
 #include <stdio.h>
 #include <string>
 #include <list>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "filelist.h"
 
 #define DefaultMaxFileNameSize (512 * 1024)
 
+class fsbackend;
+
 namespace fileop {
+	/**
+	 * @brief The identity of a file, changes when the file is replaced or modified.
+	*/
+	typedef struct fileid {
+		unsigned long long dev = 0;
+		unsigned long long ino = 0;
+		unsigned long long size = 0;
+		/// Modification time in nanoseconds
+		long long mtime = 0;
+		/// Status change time in nanoseconds (creation time on Windows)
+		long long ctime = 0;
+	} fileid;
+	/**
+	 * @brief Get the backend which file system operations go through, native by default
+	*/
+	fsbackend& backend();
+	/**
+	 * @brief Replace the backend. Only for benchmarks and tests, set it before any file operation.
+	 * @param b The backend, NULL to restore the native one. It must live until replaced.
+	*/
+	void setBackend(fsbackend* b);
 	/**
 	 * \brief Open file.
 	 * \param fname File Name (UTF-8 / ANSI encoding)
@@ -41,13 +68,13 @@ namespace fileop {
 	*/
 	bool close(FILE* f);
 	/**
-	 * @brief Split file name to name without ext and ext.
+	 * @brief Split file name to name without ext and ext. See pathview to split without allocating.
 	 * @param fname File name
 	 * @param name Name without ext. Can be NULL if don't needed.
 	 * @param ext Ext (contains `.`). Can be NULL if don't needed.
 	 * @return true if OK
 	*/
-	bool splitext(const std::string fname, std::string* name, std::string* ext);
+	bool splitext(std::string_view fname, std::string* name, std::string* ext);
 	/**
 	 * \brief Concat file path. гиJust simple base + ext).
 	 * This function will alloc memory by calling malloc, need free mannally.
@@ -111,6 +138,106 @@ namespace fileop {
 	 * @return command return value
 	*/
 	int system(const char* command);
+	/**
+	 * @brief Executes a program directly without a shell and wait it exit
+	 * @param args Arguments, the first one is the program. If it don't contain a path separator, will search it in PATH.
+	 * @param started Called once the program is started, before waiting it exit. Not called if can not start it. (Called before starting on Windows)
+	 * @return the exit code of the program, or -1 if can not start it.
+	*/
+	int spawn(const std::list<std::string>& args, const std::function<void()>& started = nullptr);
+	/**
+	 * @brief Executes a program directly without a shell and collect its output. The program will be killed if it runs too long.
+	 * @param args Arguments, the first one is the program.
+	 * @param timeout Timeout in milliseconds, negative means no timeout. (Not supported on Windows)
+	 * @param output Standard output of the program, can be NULL if don't needed. Standard error is discarded.
+	 * @return the exit code of the program, or -1 if can not start it or it is killed because of timeout.
+	*/
+	int run(const std::list<std::string>& args, int timeout = -1, std::string* output = nullptr);
+	/**
+	 * @brief Replace current process with a program. Not supported on Windows, will call spawn and exit instead.
+	 * @param args Arguments, the first one is the program. If it don't contain a path separator, will search it in PATH.
+	 * @return -1 if failed, this function will not return if succeeded.
+	*/
+	int exec(const std::list<std::string>& args);
+	/**
+	 * @brief Get the identity of a file
+	 * @param path The path
+	 * @param id Result
+	 * @return true if OK
+	*/
+	bool getFileId(std::string path, fileid& id);
+	/**
+	 * @brief Get the absolute path with all symbolic links resolved
+	 * @param path The path
+	 * @return the absolute path, if failed, will be empty
+	*/
+	std::string realpath(std::string path);
+	/**
+	 * @brief Search an executable file in PATH like shell does
+	 * @param name The program name. If it contains a path separator, PATH will not be searched.
+	 * @return the absolute path of the executable file, if not found, will be empty
+	*/
+	std::string which(std::string name);
+	/**
+	 * @brief Create directory and all its parents if not exists
+	 * @param path The directory path
+	 * @return true if OK or already exists
+	*/
+	bool mkdirs(std::string path);
+	/**
+	 * @brief Atomically move a file to dest, dest will be replaced if exists
+	 * @param src Source file
+	 * @param dest Dest file
+	 * @return true if OK
+	*/
+	bool replace(std::string src, std::string dest);
+	/**
+	 * @brief Make dest refer to src. Symbolic link is used on POSIX. Hard link is used on Windows, and copying if can not.
+	 * @param src Source file
+	 * @param dest Dest file, should not exist
+	 * @return true if OK
+	*/
+	bool link(std::string src, std::string dest);
+	/**
+	 * @brief Remove a file or a link, or a directory with everything in it. Links are removed, not followed.
+	 * @param path The path
+	 * @return true if OK
+	*/
+	bool removeAll(std::string path);
+	/**
+	 * @brief Set the modification time of a file or directory to now
+	 * @param path The path
+	 * @return true if OK
+	*/
+	bool touch(std::string path);
+	/**
+	 * @brief Read whole file
+	 * @param path The file path
+	 * @param data Result
+	 * @param maxSize If the file is bigger than this, will fail
+	 * @return true if OK
+	*/
+	bool readFile(std::string path, std::string& data, size_t maxSize = 16 * 1024 * 1024);
+	/**
+	 * @brief Write whole file by writing a temporary file first and replacing the file, so readers never see a partial file
+	 * @param path The file path
+	 * @param data Data
+	 * @param len The size of data
+	 * @return true if OK
+	*/
+	bool writeFile(std::string path, const char* data, size_t len);
+	/**
+	 * @brief Get the cache directory of ffplay-starter, will create it if not exists
+	 * @return the directory path, if failed, will be empty
+	*/
+	std::string getCacheDir();
+	/**
+	 * @brief Remove cache entries which are not used for some days. Users of a cache entry touch it (see touch) when they reuse it.
+	 * Only does the work once a day, other calls return at once.
+	 * @param days Entries not used for so many days are removed, 0 or negative to keep all
+	 * @return the count of removed entries
+	*/
+	size_t trimCache(int days);
 	/**
 	 * @brief Get program location
 	 * @return the program's location, if can not find, will be empty
@@ -123,7 +250,7 @@ namespace fileop {
 	 * @param fl Result list
 	 * @return true if OK
 	*/
-	bool win32FindFile(const char* fname, std::list<std::string>& fl);
+	bool win32FindFile(const char* fname, filelist& fl);
 #endif
 	/**
 	 * @brief Combine Directory and File Name
@@ -131,7 +258,7 @@ namespace fileop {
 	 * @param name File Name
 	 * @return Result
 	*/
-	std::string combilePath(std::string base, std::string name);
+	std::string combilePath(std::string_view base, std::string_view name);
 	/**
 	 * @brief split path to directory name and file name
 	 * @param path The path
@@ -139,14 +266,14 @@ namespace fileop {
 	 * @param name The file name
 	 * @return true if OK
 	*/
-	bool split(std::string path, std::string* dir, std::string* name);
+	bool split(std::string_view path, std::string* dir, std::string* name);
 	/**
 	 * @brief Add Directory to File Name list
 	 * @param base Directory
 	 * @param fl File Name list
 	 * @return true if OK
 	*/
-	bool addDirectoryToFileNameList(std::string base, std::list<std::string>& fl);
+	bool addDirectoryToFileNameList(std::string base, filelist& fl);
 	/**
 	 * @brief List directory
 	 * @param path directory path
@@ -154,14 +281,23 @@ namespace fileop {
 	 * @param fullpath Whether to return full path
 	 * @return true if OK
 	*/
-	bool listdir(std::string path, std::list<std::string>& fl, bool fullpath = true);
+	bool listdir(std::string path, filelist& fl, bool fullpath = true);
 	/**
 	 * @brief List relative files of file
 	 * @param file The file path
 	 * @param fl The list of relative files (Full path)
+	 * @param useIndex Whether to use and build the persistent index of the directory (see dirindex)
 	 * @return true if OK
 	*/
-	bool listrelative(std::string file, std::list<std::string>& fl);
+	bool listrelative(std::string file, filelist& fl, bool useIndex = true);
+	/**
+	 * @brief List relative files of file from the persistent index of the directory only.
+	 * The directory is not accessed and the index may be stale, used when the directory is too slow to list.
+	 * @param file The file path
+	 * @param fl The list of relative files (Full path)
+	 * @return true if the index exists
+	*/
+	bool listrelativeCached(std::string file, filelist& fl);
 	/**
 	 * @brief Filter file list by 
 	 * @param fl File list (Full path)
@@ -170,7 +306,7 @@ namespace fileop {
 	 * @param filter_no_ext whether to filter file which don't have a ext
 	 * @return true if OK
 	*/
-	bool filterFileListByExt(std::list<std::string> fl, std::list<std::string> exts, std::list<std::string>& result, bool filter_no_ext = true);
+	bool filterFileListByExt(const filelist& fl, const std::vector<std::string_view>& exts, filelist& result, bool filter_no_ext = true);
 }
 
 #endif
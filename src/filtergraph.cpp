@@ -0,0 +1,29 @@
+#include "filtergraph.h"
+
+void filtergraph::add(stage s, std::string filter) {
+	if (filter.empty()) return;
+	auto i = filters.end();
+	while (i != filters.begin() && (i - 1)->s > s) --i;
+	filters.insert(i, { s, std::move(filter) });
+}
+
+bool filtergraph::has(stage s) const {
+	for (auto i = filters.begin(); i != filters.end(); ++i) {
+		if (i->s == s) return true;
+	}
+	return false;
+}
+
+std::string filtergraph::str() const {
+	std::string s;
+	for (auto i = filters.begin(); i != filters.end(); ++i) {
+		if (!s.empty()) s += ',';
+		s += i->filter;
+	}
+	return s;
+}
+
+std::string filtergraph::scaleDown(int width) {
+	/* Quotes keep the comma of min() out of the chain. -2 keeps the height even for yuv420p. */
+	return "scale=w='min(iw," + std::to_string(width) + ")':h=-2";
+}
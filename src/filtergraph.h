@@ -0,0 +1,51 @@
+#ifndef _ST_FILTERGRAPH_H
+#define _ST_FILTERGRAPH_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Plan the video filtergraph passed to ffplay.
+ * ffplay treats every -vf as an alternative graph which can be switched at runtime, not as a chain,
+ * so all filters must be joined into one graph. Filters are ordered by stage, then by adding order.
+*/
+class filtergraph {
+public:
+	enum stage : unsigned char {
+		/// Filters changing the frame size, run first so later filters work at output size
+		GEOMETRY,
+		/// Filters drawing on frames, such as subtitles
+		RENDER,
+	};
+	/**
+	 * @brief Add a filter
+	 * @param s The stage
+	 * @param filter The filter with its escaped arguments, such as `subtitles=a.ass`
+	*/
+	void add(stage s, std::string filter);
+	/**
+	 * @brief Check whether any filter is added to a stage
+	*/
+	bool has(stage s) const;
+	bool empty() const {
+		return filters.empty();
+	}
+	/**
+	 * @brief Get the whole graph as one chain
+	*/
+	std::string str() const;
+	/**
+	 * @brief Get a filter scaling frames down to a width, keeping aspect ratio. Smaller frames are not upscaled.
+	 * @param width The max width
+	 * @return the filter
+	*/
+	static std::string scaleDown(int width);
+private:
+	typedef struct item {
+		stage s;
+		std::string filter;
+	} item;
+	std::vector<item> filters;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef _ST_FSBACKEND_H
+#define _ST_FSBACKEND_H
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include "fileop.h"
+
+class dirscan;
+
+/**
+ * @brief File system operations used by fileop, dirscan and dirindex.
+ * The native backend calls the operating system, other backends are used to benchmark and test scanning code without disk.
+ * Paths are UTF-8, directories passed to listdir always end with path separator.
+*/
+class fsbackend {
+public:
+	virtual ~fsbackend() = default;
+	/**
+	 * @brief List a directory into scanner, entries starting with `.` are skipped
+	 * @param dir The directory path, ends with path separator
+	 * @param prefix Only add entries whose name starts with it
+	 * @param out The scanner, entries are added by dirscan::add
+	 * @return true if OK
+	*/
+	virtual bool listdir(const std::string& dir, std::string_view prefix, dirscan& out) = 0;
+	/**
+	 * @brief Get the identity of a file or directory
+	 * @return true if OK
+	*/
+	virtual bool stat(const std::string& path, fileop::fileid& id) = 0;
+	virtual bool exists(const std::string& path) = 0;
+	virtual bool readFile(const std::string& path, std::string& data, size_t maxSize) = 0;
+	/**
+	 * @brief Write whole file atomically, readers never see a partial file
+	*/
+	virtual bool writeFile(const std::string& path, const char* data, size_t len) = 0;
+	/**
+	 * @brief Create a directory, the parent must exist
+	 * @return true if OK or already exists
+	*/
+	virtual bool mkdir(const std::string& path) = 0;
+	/**
+	 * @brief Set the modification time of a file or directory to now
+	 * @return true if OK
+	*/
+	virtual bool touch(const std::string& path) = 0;
+	/**
+	 * @brief Whether this backend is the operating system, so paths can be used by other system calls such as mmap
+	*/
+	virtual bool native() const {
+		return false;
+	}
+};
+
+class nativebackend : public fsbackend {
+public:
+	bool listdir(const std::string& dir, std::string_view prefix, dirscan& out) override;
+	bool stat(const std::string& path, fileop::fileid& id) override;
+	bool exists(const std::string& path) override;
+	bool readFile(const std::string& path, std::string& data, size_t maxSize) override;
+	bool writeFile(const std::string& path, const char* data, size_t len) override;
+	bool mkdir(const std::string& path) override;
+	bool touch(const std::string& path) override;
+	bool native() const override {
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "fsinfo.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#include <windows.h>
+#elif defined(HAVE_STATFS)
+#include <sys/vfs.h>
+#endif
+#include "fileop.h"
+#include "pathview.h"
+#include "console.h"
+#include "trace.h"
+#include "util.h"
+
+/// Staging bigger files is not worth it
+#define STAGE_MAX_SIZE (16 * 1024 * 1024)
+
+#if !defined(_WIN32) && defined(HAVE_STATFS)
+typedef struct fs_magic {
+	unsigned long magic;
+	const char* name;
+	fsinfo::fskind kind;
+} fs_magic;
+
+/* Values of f_type, see statfs(2). */
+static const fs_magic magics[] = {
+	{ 0xEF53, "ext4", fsinfo::FS_LOCAL },
+	{ 0x58465342, "xfs", fsinfo::FS_LOCAL },
+	{ 0x9123683E, "btrfs", fsinfo::FS_LOCAL },
+	{ 0xF2F52010, "f2fs", fsinfo::FS_LOCAL },
+	{ 0x2FC12FC1, "zfs", fsinfo::FS_LOCAL },
+	{ 0x794C7630, "overlayfs", fsinfo::FS_LOCAL },
+	{ 0x4D44, "vfat", fsinfo::FS_LOCAL },
+	{ 0x2011BAB0, "exfat", fsinfo::FS_LOCAL },
+	{ 0x5346544E, "ntfs", fsinfo::FS_LOCAL },
+	{ 0x7366746E, "ntfs3", fsinfo::FS_LOCAL },
+	{ 0x9660, "iso9660", fsinfo::FS_LOCAL },
+	{ 0x15013346, "udf", fsinfo::FS_LOCAL },
+	{ 0x73717368, "squashfs", fsinfo::FS_LOCAL },
+	{ 0x01021994, "tmpfs", fsinfo::FS_MEMORY },
+	{ 0x858458F6, "ramfs", fsinfo::FS_MEMORY },
+	{ 0x6969, "nfs", fsinfo::FS_NETWORK },
+	{ 0x517B, "smb", fsinfo::FS_NETWORK },
+	{ 0xFF534D42, "cifs", fsinfo::FS_NETWORK },
+	{ 0xFE534D42, "smb2", fsinfo::FS_NETWORK },
+	{ 0x01021997, "9p", fsinfo::FS_NETWORK },
+	{ 0x00C36400, "ceph", fsinfo::FS_NETWORK },
+	{ 0x5346414F, "afs", fsinfo::FS_NETWORK },
+	{ 0x6B414653, "afs", fsinfo::FS_NETWORK },
+	{ 0x47504653, "gpfs", fsinfo::FS_NETWORK },
+	{ 0x65735546, "fuse", fsinfo::FS_FUSE },
+	{ 0, nullptr, fsinfo::FS_UNKNOWN },
+};
+#endif
+
+fsinfo::fsentry fsinfo::detect(std::string path) {
+	fsentry re;
+	if (path.empty()) return re;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	if ((path[0] == '\\' || path[0] == '/') && (path[1] == '\\' || path[1] == '/')) {
+		re.kind = FS_NETWORK;
+		re.name = "unc";
+		return re;
+	}
+	if (path.length() < 2 || path[1] != ':') return re;
+	char root[] = { path[0], ':', '\\', 0 };
+	switch (GetDriveTypeA(root)) {
+	case DRIVE_REMOTE:
+		re.kind = FS_NETWORK;
+		re.name = "remote";
+		break;
+	case DRIVE_RAMDISK:
+		re.kind = FS_MEMORY;
+		re.name = "ramdisk";
+		break;
+	case DRIVE_FIXED:
+	case DRIVE_REMOVABLE:
+	case DRIVE_CDROM:
+		re.kind = FS_LOCAL;
+		re.name = "local";
+		break;
+	}
+#elif defined(HAVE_STATFS)
+	struct statfs st;
+	if (statfs(path.c_str(), &st)) return re;
+	auto type = (unsigned long)(uint32_t)st.f_type;
+	for (auto m = magics; m->name; m++) {
+		if (m->magic == type) {
+			re.kind = m->kind;
+			re.name = m->name;
+			return re;
+		}
+	}
+	char buf[32];
+	snprintf(buf, sizeof(buf), "0x%lx", type);
+	re.name = buf;
+	/* Unknown local file systems are more common than unknown network ones. */
+	re.kind = FS_LOCAL;
+#endif
+	return re;
+}
+
+const char* kindName(fsinfo::fskind kind) {
+	switch (kind) {
+	case fsinfo::FS_LOCAL:
+		return "local";
+	case fsinfo::FS_MEMORY:
+		return "memory";
+	case fsinfo::FS_NETWORK:
+		return "network";
+	case fsinfo::FS_FUSE:
+		return "fuse";
+	default:
+		return "unknown";
+	}
+}
+
+inline bool isRemote(fsinfo::fskind kind) {
+	return kind == fsinfo::FS_NETWORK || kind == fsinfo::FS_FUSE;
+}
+
+fsinfo::strategy fsinfo::choose(std::string filename, const config* conf) {
+	trace::scope t("fsStrategy", filename.c_str());
+	strategy s;
+	s.file = detect(filename);
+	auto dir = pathview(filename).dir();
+	if (!dir.empty()) s.dir = detect(pathview::native(dir));
+	else s.dir = s.file;
+	int readahead = conf ? conf->readaheadSize : 4;
+	bool index = !conf || conf->dirIndex;
+	/* Scanning memory is cheap, remote directories are worth indexing even if small. */
+	s.useIndex = index && s.dir.kind != FS_MEMORY;
+	switch (s.file.kind) {
+	case FS_MEMORY:
+		s.readaheadSize = 0;
+		break;
+	case FS_NETWORK:
+	case FS_FUSE:
+		/* Hide round trips: read more ahead, probe less before playing. */
+		s.readaheadSize = readahead > 0 ? (readahead < 16 ? 16 : readahead) : 0;
+		s.probesize = "2M";
+		s.analyzeduration = "2000000";
+		break;
+	default:
+		s.readaheadSize = readahead;
+		break;
+	}
+	s.stage = isRemote(s.file.kind) || isRemote(s.dir.kind);
+	auto desc = toString(s);
+	console::verbose("File system strategy: %s", desc.c_str());
+	if (trace::enabled) trace::complete("fsStrategyResult", trace::now(), trace::now(), desc.c_str());
+	return s;
+}
+
+std::string fsinfo::toString(const strategy& s) {
+	std::string re = "file on " + s.file.name + " (" + kindName(s.file.kind) + "), directory on " + s.dir.name + " (" + kindName(s.dir.kind) + ")";
+	re += s.useIndex ? ", use directory index" : ", scan directory";
+	re += ", readahead " + std::to_string(s.readaheadSize) + " MiB";
+	if (!s.probesize.empty()) re += ", probesize " + s.probesize;
+	if (!s.analyzeduration.empty()) re += ", analyzeduration " + s.analyzeduration;
+	if (s.stage) re += ", stage subtitles";
+	return re;
+}
+
+std::string fsinfo::stage(std::string path) {
+	trace::scope t("stage", path.c_str());
+	fileop::fileid id;
+	if (!fileop::getFileId(path, id) || id.size > STAGE_MAX_SIZE) return path;
+	auto cache = fileop::getCacheDir();
+	if (cache.empty()) return path;
+	auto dir = fileop::combilePath(cache, "staging");
+	if (!fileop::mkdirs(dir)) return path;
+	/* Any change of the file gives a new name, so a copy is never stale. */
+	uint64_t h = util::fnv1a(FNV1A_INIT, path.data(), path.length());
+	char name[96];
+	snprintf(name, sizeof(name), "%016llx-%llx-%llx", (unsigned long long)h, id.size, (unsigned long long)id.mtime);
+	auto local = fileop::combilePath(dir, name);
+	local += pathview(path).ext();
+	if (fileop::touch(local)) {
+		console::verbose("Use staged copy of \"%s\": %s", path.c_str(), local.c_str());
+		return local;
+	}
+	std::string data;
+	if (!fileop::readFile(path, data, STAGE_MAX_SIZE) || !fileop::writeFile(local, data.c_str(), data.length())) {
+		console::verbose("Can not stage \"%s\".", path.c_str());
+		return path;
+	}
+	console::verbose("Staged \"%s\" to \"%s\".", path.c_str(), local.c_str());
+	return local;
+}
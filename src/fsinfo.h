@@ -0,0 +1,69 @@
+#ifndef _ST_FSINFO_H
+#define _ST_FSINFO_H
+
+#include <string>
+#include "configfile.h"
+
+namespace fsinfo {
+	/**
+	 * @brief The kind of file system, decides how files on it are accessed
+	*/
+	enum fskind {
+		FS_UNKNOWN,
+		/// Local disk
+		FS_LOCAL,
+		/// tmpfs or ramfs, everything is already in memory
+		FS_MEMORY,
+		/// NFS, SMB/CIFS and other network file systems
+		FS_NETWORK,
+		/// FUSE, such as sshfs and rclone, usually slow and remote
+		FS_FUSE,
+	};
+	typedef struct fsentry {
+		fskind kind = FS_UNKNOWN;
+		/// File system name, such as ext4 or nfs
+		std::string name = "unknown";
+	} fsentry;
+	/**
+	 * @brief How to access the media file and its directory
+	*/
+	typedef struct strategy {
+		fsentry file;
+		fsentry dir;
+		/// Whether to use the persistent directory index (see dirindex) instead of scanning every time
+		bool useIndex = true;
+		/// The size in MiB read ahead at the head and the tail of media file, 0 to disable
+		int readaheadSize = 0;
+		/// Value of ffplay -probesize, empty to keep default
+		std::string probesize;
+		/// Value of ffplay -analyzeduration, empty to keep default
+		std::string analyzeduration;
+		/// Whether to copy external subtitles to local cache
+		bool stage = false;
+	} strategy;
+	/**
+	 * @brief Detect the file system of a path
+	 * @param path The path
+	 * @return the file system, kind is FS_UNKNOWN if detect failed
+	*/
+	fsentry detect(std::string path);
+	/**
+	 * @brief Detect the file systems of the media file and its directory, and choose the strategy
+	 * @param filename The media file
+	 * @param conf Config, can be NULL
+	 * @return the strategy
+	*/
+	strategy choose(std::string filename, const config* conf);
+	/**
+	 * @brief Describe a strategy, used in verbose output and trace
+	*/
+	std::string toString(const strategy& s);
+	/**
+	 * @brief Copy a small file to local cache and reuse the copy until the file is changed
+	 * @param path The file
+	 * @return the path of local copy, or path itself if can not stage it
+	*/
+	std::string stage(std::string path);
+}
+
+#endif
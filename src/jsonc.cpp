@@ -10,6 +10,7 @@
 #include "chardet.h"
 #endif
 #include "chariconv.h"
+#include "trace.h"
 
 #define MAX_SIZE_ALLOW (2 * 1024 * 1024)
 
@@ -22,6 +23,25 @@ bool string_callback(json_object* obj, std::string& str) {
 	return true;
 }
 
+bool string_list_callback(json_object* obj, std::list<std::string>& li) {
+	if (obj == nullptr) return false;
+	std::string str;
+	if (string_callback(obj, str)) {
+		li.clear();
+		li.push_back(str);
+		return true;
+	}
+	if (json_object_get_type(obj) != json_type_array) return false;
+	std::list<std::string> tmp;
+	auto len = json_object_array_length(obj);
+	for (size_t i = 0; i < len; i++) {
+		if (!string_callback(json_object_array_get_idx(obj, i), str)) return false;
+		tmp.push_back(str);
+	}
+	li = tmp;
+	return true;
+}
+
 bool int_callback(json_object* obj, int& num) {
 	if (obj == nullptr) return false;
 	if (json_object_get_type(obj) != json_type_int) return false;
@@ -39,6 +59,24 @@ bool bool_callback(json_object* obj, bool& num) {
 	return true;
 }
 
+bool subscore_callback(json_object* obj, subscore& score) {
+	if (obj == nullptr) return false;
+	if (json_object_get_type(obj) != json_type_object) return false;
+	struct {
+		const char* key;
+		int* value;
+	} fields[] = {
+		{ "language", &score.language }, { "untagged", &score.untagged }, { "ass", &score.ass }, { "ssa", &score.ssa },
+		{ "srt", &score.srt }, { "vtt", &score.vtt }, { "sup", &score.sup }, { "sameDirectory", &score.sameDirectory },
+		{ "subdirectory", &score.subdirectory }, { "forced", &score.forced }, { "sdh", &score.sdh },
+	};
+	for (auto& f : fields) {
+		json_object* t = nullptr;
+		if (json_object_object_get_ex(obj, f.key, &t)) int_callback(t, *f.value);
+	}
+	return true;
+}
+
 template<typename ... Args>
 bool read_json_object(json_object* obj, const char* key, bool(*callback)(json_object* obj, Args... args), Args... args) {
 	if (obj == nullptr) return false;
@@ -49,6 +87,7 @@ bool read_json_object(json_object* obj, const char* key, bool(*callback)(json_ob
 }
 
 int jsonc::read_json_file(const char* fname, config& conf) {
+	trace::scope t("jsonc::read_json_file", fname);
 	FILE* f = fileop::open(fname, "rb");
 	if (!f) {
 		console::warn("Can not open config file \"%s\".", fname);
@@ -111,6 +150,7 @@ int jsonc::read_json_file(const char* fname, config& conf) {
 #endif
 			char* new_str = nullptr;
 			size_t new_strl = 0;
+			trace::scope tconv("chariconv::convert", encoding);
 			if (chariconv::convert(buf, size, new_str, new_strl, encoding, "UTF-8")) {
 				if (new_str) {
 					free(ori_buf);
@@ -166,8 +206,13 @@ int jsonc::read_json_file(const char* fname, config& conf) {
 		while (!json_object_put(root));
 		return 1;
 	}
-	if (read_json_object<std::string&>(root, "ffplay", &string_callback, conf.ffplay)) {
-		console::verbose("Read ffplay setting from \"%s\": %s", fname, conf.ffplay.c_str());
+	if (read_json_object<std::list<std::string>&>(root, "ffplay", &string_list_callback, conf.ffplay)) {
+		for (auto i = conf.ffplay.begin(); i != conf.ffplay.end(); ++i) {
+			console::verbose("Read ffplay setting from \"%s\": %s", fname, i->c_str());
+		}
+	}
+	if (read_json_object<int&>(root, "probeTimeout", &int_callback, conf.probeTimeout)) {
+		console::verbose("Read probeTimeout setting from \"%s\": %i", fname, conf.probeTimeout);
 	}
 	if (read_json_object<int&>(root, "width", &int_callback, conf.width)) {
 		console::verbose("Read width setting from \"%s\": %i", fname, conf.width);
@@ -175,6 +220,38 @@ int jsonc::read_json_file(const char* fname, config& conf) {
 	if (read_json_object<bool&>(root, "autoExit", &bool_callback, conf.autoExit)) {
 		console::verbose("Read autoExit settings from \"%s\": %s", fname, conf.autoExit ? "true" : "false");
 	}
+	if (read_json_object<bool&>(root, "prefetch", &bool_callback, conf.prefetch)) {
+		console::verbose("Read prefetch settings from \"%s\": %s", fname, conf.prefetch ? "true" : "false");
+	}
+	if (read_json_object<int&>(root, "readaheadSize", &int_callback, conf.readaheadSize)) {
+		console::verbose("Read readaheadSize setting from \"%s\": %i", fname, conf.readaheadSize);
+	}
+	if (read_json_object<int&>(root, "scanTimeout", &int_callback, conf.scanTimeout)) {
+		console::verbose("Read scanTimeout setting from \"%s\": %i", fname, conf.scanTimeout);
+	}
+	if (read_json_object<bool&>(root, "dirIndex", &bool_callback, conf.dirIndex)) {
+		console::verbose("Read dirIndex settings from \"%s\": %s", fname, conf.dirIndex ? "true" : "false");
+	}
+	if (read_json_object<bool&>(root, "assFonts", &bool_callback, conf.assFonts)) {
+		console::verbose("Read assFonts settings from \"%s\": %s", fname, conf.assFonts ? "true" : "false");
+	}
+	if (read_json_object<bool&>(root, "transcodeSubtitles", &bool_callback, conf.transcodeSubtitles)) {
+		console::verbose("Read transcodeSubtitles settings from \"%s\": %s", fname, conf.transcodeSubtitles ? "true" : "false");
+	}
+	if (read_json_object<int&>(root, "cacheDays", &int_callback, conf.cacheDays)) {
+		console::verbose("Read cacheDays setting from \"%s\": %i", fname, conf.cacheDays);
+	}
+	if (read_json_object<std::list<std::string>&>(root, "subtitleLanguages", &string_list_callback, conf.subtitleLanguages)) {
+		for (auto i = conf.subtitleLanguages.begin(); i != conf.subtitleLanguages.end(); ++i) {
+			console::verbose("Read subtitleLanguages setting from \"%s\": %s", fname, i->c_str());
+		}
+	}
+	if (read_json_object<int&>(root, "maxSubtitles", &int_callback, conf.maxSubtitles)) {
+		console::verbose("Read maxSubtitles setting from \"%s\": %i", fname, conf.maxSubtitles);
+	}
+	if (read_json_object<subscore&>(root, "subtitleScore", &subscore_callback, conf.subtitleScore)) {
+		console::verbose("Read subtitleScore settings from \"%s\".", fname);
+	}
 	while (!json_object_put(root));
 	return 0;
 }
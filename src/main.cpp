@@ -3,6 +3,8 @@
 #include "config.h"
 #endif
 #include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include "configfile.h"
 #ifdef HAVE_JSONC
 #include "jsonc.h"
@@ -11,20 +13,15 @@
 #include "console.h"
 #include "util.h"
 #include "starter.h"
+#include "taskpool.h"
+#include "trace.h"
 
-int main(int argc, char *argv[]) {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-	auto setcp = console::setOutputCP();
-#endif
-	cml cm(argc, argv);
-	if (cm.print_help()) {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-		if (setcp && cm.rcp) console::resetOutputCP();
-#endif
-		return cm.have_error() ? 1 : 0;
-	}
-	char* base = NULL;
-	config conf;
+/**
+ * @brief Find config file next to the program and read it
+ * @param conf Config
+*/
+void loadConfig([[maybe_unused]] config& conf) {
+	trace::scope t("loadConfig");
 	std::string sloc = fileop::getProgramLocation();
 	if (!sloc.empty()) {
 		console::verbose("Get program location: %s", sloc.c_str());
@@ -40,11 +37,47 @@ int main(int argc, char *argv[]) {
 #endif
 		}
 	}
-	starter st(cm, conf);
-	auto re = st.start();
+}
+
+int main(int argc, char *argv[]) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	auto setcp = console::setOutputCP();
+#endif
+	auto cmlbegin = trace::now();
+	cml cm(argc, argv);
+	if (!cm.trace.empty()) {
+		trace::start(cm.trace);
+		trace::complete("cml", cmlbegin, trace::now());
+	}
+	if (cm.print_help()) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+		if (setcp && cm.rcp) console::resetOutputCP();
+#endif
+		return cm.have_error() ? 1 : 0;
+	}
+	config conf;
+	int re;
+	bool abandoned;
+	{
+		/* Startup steps run on the pool, the launch only waits the steps it needs. */
+		taskpool pool(4);
+		auto confready = pool.submit([&conf]() {
+			loadConfig(conf);
+		});
+		starter st(cm, conf);
+		re = st.start(pool, confready);
+		abandoned = st.abandoned();
+	}
+	trace::finish();
 	console::verbose("Ffplay returned %d.", re);
 #if defined(_WIN32) && !defined(__CYGWIN__)
 	if (setcp && cm.rcp) console::resetOutputCP();
 #endif
+	if (abandoned) {
+		/* Skip static destructors, the media scan still running uses them. */
+		fflush(stdout);
+		fflush(stderr);
+		_Exit(re);
+	}
 	return re;
 }
@@ -0,0 +1,49 @@
+#include "pathview.h"
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#define NATIVE_SEP '\\'
+#define FOREIGN_SEP '/'
+#else
+#define NATIVE_SEP '/'
+#define FOREIGN_SEP '\\'
+#endif
+
+pathview::pathview(std::string_view path) : path(path) {
+	auto len = path.length();
+	extpos = len;
+	size_t i = len;
+	while (i > 0) {
+		char c = path[i - 1];
+		if (isSeparator(c)) break;
+		if (c == '.' && extpos == len) extpos = i - 1;
+		i--;
+	}
+	namepos = i;
+}
+
+void pathview::appendNative(std::string& out, std::string_view s) {
+	auto start = out.length();
+	out.append(s);
+	for (auto i = start; i < out.length(); i++) {
+		if (out[i] == FOREIGN_SEP) out[i] = NATIVE_SEP;
+	}
+}
+
+void pathview::join(std::string& out, std::string_view base, std::string_view name) {
+	out.reserve(out.length() + base.length() + name.length() + 1);
+	appendNative(out, base);
+	if (!base.empty() && !isSeparator(base.back())) out += NATIVE_SEP;
+	appendNative(out, name);
+}
+
+std::string pathview::join(std::string_view base, std::string_view name) {
+	std::string s;
+	join(s, base, name);
+	return s;
+}
+
+std::string pathview::native(std::string_view s) {
+	std::string re;
+	appendNative(re, s);
+	return re;
+}
@@ -0,0 +1,98 @@
+#ifndef _ST_PATHVIEW_H
+#define _ST_PATHVIEW_H
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief A path split into directory, file name and ext without allocating.
+ * Boundaries are found by one backward scan, parts are views into the original string
+ * and keep its separators. Separators are converted only when a path is materialized.
+ * The original string must outlive the view.
+*/
+class pathview {
+public:
+	pathview(std::string_view path);
+	/**
+	 * @brief Get the whole path
+	*/
+	std::string_view str() const {
+		return path;
+	}
+	/**
+	 * @brief Get the directory, contains the last separator. Empty if the path has no directory.
+	*/
+	std::string_view dir() const {
+		return path.substr(0, namepos);
+	}
+	/**
+	 * @brief Get the file name
+	*/
+	std::string_view name() const {
+		return path.substr(namepos);
+	}
+	/**
+	 * @brief Get the path without ext, same as the name of fileop::splitext
+	*/
+	std::string_view stem() const {
+		return path.substr(0, extpos);
+	}
+	/**
+	 * @brief Get the file name without ext
+	*/
+	std::string_view nameStem() const {
+		return extpos > namepos ? path.substr(namepos, extpos - namepos) : std::string_view();
+	}
+	/**
+	 * @brief Get the ext (contains `.`), empty if not exists. Same as the ext of fileop::splitext
+	*/
+	std::string_view ext() const {
+		return path.substr(extpos);
+	}
+	/**
+	 * @brief Get the position of the file name
+	*/
+	size_t namePosition() const {
+		return namepos;
+	}
+	/**
+	 * @brief Get the position of the ext, equals to the length if no ext
+	*/
+	size_t extPosition() const {
+		return extpos;
+	}
+	/**
+	 * @brief Check whether a character is a path separator
+	*/
+	static bool isSeparator(char c) {
+		return c == '/' || c == '\\';
+	}
+	/**
+	 * @brief Append a string and convert separators to the native one
+	 * @param out The output
+	 * @param s The string
+	*/
+	static void appendNative(std::string& out, std::string_view s);
+	/**
+	 * @brief Append a path joined from a directory and a name, with native separators
+	 * @param out The output
+	 * @param base The directory, a separator is added if it not ends with one
+	 * @param name The name
+	*/
+	static void join(std::string& out, std::string_view base, std::string_view name);
+	/**
+	 * @brief Join a directory and a name, with native separators
+	*/
+	static std::string join(std::string_view base, std::string_view name);
+	/**
+	 * @brief Copy a string with native separators
+	*/
+	static std::string native(std::string_view s);
+private:
+	std::string_view path;
+	size_t namepos = 0;
+	size_t extpos = 0;
+};
+
+#endif
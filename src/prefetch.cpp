@@ -0,0 +1,370 @@
+#include "prefetch.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_MINCORE
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_ELF_H
+#include <elf.h>
+#endif
+#include "fileop.h"
+#include "pathview.h"
+#include "console.h"
+#include "trace.h"
+
+#ifdef HAVE_ELF_H
+/**
+ * @brief The information of an ELF file needed to resolve its dependencies
+*/
+typedef struct elf_info {
+	unsigned char elfclass = 0;
+	uint16_t machine = 0;
+	std::string interp;
+	std::list<std::string> needed;
+	std::list<std::string> rpath;
+	std::list<std::string> runpath;
+} elf_info;
+
+bool preadAll(int fd, void* buf, size_t len, off_t off) {
+	auto p = (char*)buf;
+	while (len > 0) {
+		auto n = pread(fd, p, len, off);
+		if (n <= 0) return false;
+		p += n;
+		len -= n;
+		off += n;
+	}
+	return true;
+}
+
+/**
+ * @brief Split a search path list (separated by ':') and replace $ORIGIN
+*/
+std::list<std::string> splitSearchPath(const std::string& value, const std::string& origin) {
+	std::list<std::string> re;
+	size_t start = 0;
+	while (start <= value.length()) {
+		auto end = value.find(':', start);
+		if (end == std::string::npos) end = value.length();
+		auto dir = value.substr(start, end - start);
+		start = end + 1;
+		if (dir.empty()) continue;
+		auto loc = dir.find("$ORIGIN");
+		if (loc == std::string::npos) loc = dir.find("${ORIGIN}");
+		if (loc != std::string::npos) {
+			auto len = dir[loc + 1] == '{' ? 9 : 7;
+			dir.replace(loc, len, origin);
+		}
+		/* $LIB and $PLATFORM depends on the dynamic linker, skip them. */
+		if (dir.find('$') != std::string::npos) continue;
+		re.push_back(dir);
+	}
+	return re;
+}
+
+template <typename Ehdr, typename Phdr, typename Dyn>
+bool readElfInfo(int fd, const std::string& path, elf_info& info) {
+	Ehdr eh;
+	if (!preadAll(fd, &eh, sizeof(eh), 0)) return false;
+	info.machine = eh.e_machine;
+	if (eh.e_phentsize != sizeof(Phdr) || eh.e_phnum == 0 || eh.e_phnum > 4096) return false;
+	std::vector<Phdr> phs(eh.e_phnum);
+	if (!preadAll(fd, phs.data(), sizeof(Phdr) * phs.size(), eh.e_phoff)) return false;
+	const Phdr* dynamic = nullptr;
+	for (auto i = phs.begin(); i != phs.end(); ++i) {
+		if (i->p_type == PT_DYNAMIC) dynamic = &*i;
+		if (i->p_type == PT_INTERP && i->p_filesz > 1 && i->p_filesz < 4096) {
+			std::string interp(i->p_filesz, 0);
+			if (preadAll(fd, &interp[0], i->p_filesz, i->p_offset)) info.interp = interp.c_str();
+		}
+	}
+	/* Statically linked. */
+	if (!dynamic) return true;
+	size_t count = dynamic->p_filesz / sizeof(Dyn);
+	if (count == 0 || count > 65536) return false;
+	std::vector<Dyn> dyns(count);
+	if (!preadAll(fd, dyns.data(), sizeof(Dyn) * count, dynamic->p_offset)) return false;
+	uint64_t strtab = 0, strsz = 0;
+	std::list<uint64_t> needed;
+	uint64_t rpath = (uint64_t)-1, runpath = (uint64_t)-1;
+	for (auto i = dyns.begin(); i != dyns.end(); ++i) {
+		if (i->d_tag == DT_NULL) break;
+		switch (i->d_tag) {
+		case DT_STRTAB:
+			strtab = i->d_un.d_ptr;
+			break;
+		case DT_STRSZ:
+			strsz = i->d_un.d_val;
+			break;
+		case DT_NEEDED:
+			needed.push_back(i->d_un.d_val);
+			break;
+		case DT_RPATH:
+			rpath = i->d_un.d_val;
+			break;
+		case DT_RUNPATH:
+			runpath = i->d_un.d_val;
+			break;
+		default:
+			break;
+		}
+	}
+	if (!strsz || strsz > 16 * 1024 * 1024) return false;
+	/* DT_STRTAB is a virtual address, find the segment contains it. */
+	uint64_t stroff = (uint64_t)-1;
+	for (auto i = phs.begin(); i != phs.end(); ++i) {
+		if (i->p_type == PT_LOAD && strtab >= i->p_vaddr && strtab < i->p_vaddr + i->p_filesz) {
+			stroff = strtab - i->p_vaddr + i->p_offset;
+			break;
+		}
+	}
+	if (stroff == (uint64_t)-1) return false;
+	std::string strs(strsz, 0);
+	if (!preadAll(fd, &strs[0], strsz, stroff)) return false;
+	strs += '\0';
+	auto origin = pathview::native(pathview(path).dir());
+	if (origin.length() > 1 && origin.back() == '/') origin.pop_back();
+	for (auto i = needed.begin(); i != needed.end(); ++i) {
+		if (*i < strsz) info.needed.push_back(strs.c_str() + *i);
+	}
+	if (runpath < strsz) info.runpath = splitSearchPath(strs.c_str() + runpath, origin);
+	else if (rpath < strsz) info.rpath = splitSearchPath(strs.c_str() + rpath, origin);
+	return true;
+}
+
+bool readElfInfo(const std::string& path, elf_info& info) {
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+	unsigned char ident[EI_NIDENT];
+	bool re = false;
+	if (preadAll(fd, ident, EI_NIDENT, 0) && !memcmp(ident, ELFMAG, SELFMAG)) {
+		info.elfclass = ident[EI_CLASS];
+		if (info.elfclass == ELFCLASS64) re = readElfInfo<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn>(fd, path, info);
+		else if (info.elfclass == ELFCLASS32) re = readElfInfo<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn>(fd, path, info);
+	}
+	close(fd);
+	return re;
+}
+
+/**
+ * @brief Check whether a library can be loaded by the executable
+*/
+bool isCompatibleElf(const std::string& path, const elf_info& exe) {
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+	unsigned char buf[EI_NIDENT + 4];
+	bool re = false;
+	if (preadAll(fd, buf, sizeof(buf), 0) && !memcmp(buf, ELFMAG, SELFMAG) && buf[EI_CLASS] == exe.elfclass) {
+		uint16_t machine;
+		memcpy(&machine, buf + EI_NIDENT + 2, sizeof(machine));
+		re = machine == exe.machine;
+	}
+	close(fd);
+	return re;
+}
+
+#define LDSO_CACHE_MAGIC "glibc-ld.so.cache1.1"
+
+static std::once_flag ldcache_once;
+static std::multimap<std::string, std::string> ldcache;
+
+/**
+ * @brief Load library names and paths from /etc/ld.so.cache
+*/
+void loadLdCache() {
+	std::string data;
+	if (!fileop::readFile("/etc/ld.so.cache", data)) return;
+	auto base = data.find(LDSO_CACHE_MAGIC);
+	/* The new format may follow the old format. */
+	if (base == std::string::npos || base > 1024 * 1024) return;
+	const size_t header_size = 48, entry_size = 24;
+	if (data.length() < base + header_size) return;
+	uint32_t nlibs;
+	memcpy(&nlibs, data.data() + base + 20, sizeof(nlibs));
+	if (data.length() < base + header_size + (size_t)nlibs * entry_size) return;
+	for (uint32_t i = 0; i < nlibs; i++) {
+		uint32_t key, value;
+		auto e = data.data() + base + header_size + (size_t)i * entry_size;
+		memcpy(&key, e + 4, sizeof(key));
+		memcpy(&value, e + 8, sizeof(value));
+		if (base + key >= data.length() || base + value >= data.length()) continue;
+		ldcache.insert(std::make_pair(std::string(data.c_str() + base + key), std::string(data.c_str() + base + value)));
+	}
+}
+
+std::string findInDirs(const std::string& name, const std::list<std::string>& dirs, const elf_info& exe) {
+	for (auto i = dirs.begin(); i != dirs.end(); ++i) {
+		auto candidate = fileop::combilePath(*i, name);
+		if (isCompatibleElf(candidate, exe)) return candidate;
+	}
+	return "";
+}
+
+/**
+ * @brief Resolve DT_NEEDED library name
+ * @param name Library name
+ * @param loader The object which needs the library
+ * @param exe The executable
+ * @return the path, empty if not found
+*/
+std::string resolveLibrary(const std::string& name, const elf_info& loader, const elf_info& exe, const std::list<std::string>& ldpath) {
+	if (name.find('/') != std::string::npos) return isCompatibleElf(name, exe) ? name : "";
+	std::string re;
+	if (loader.runpath.empty()) {
+		re = findInDirs(name, loader.rpath, exe);
+		if (re.empty()) re = findInDirs(name, exe.rpath, exe);
+	}
+	if (re.empty()) re = findInDirs(name, ldpath, exe);
+	if (re.empty()) re = findInDirs(name, loader.runpath, exe);
+	if (re.empty()) {
+		std::call_once(ldcache_once, loadLdCache);
+		auto range = ldcache.equal_range(name);
+		for (auto i = range.first; i != range.second; ++i) {
+			if (isCompatibleElf(i->second, exe)) {
+				re = i->second;
+				break;
+			}
+		}
+	}
+	if (re.empty()) {
+		std::list<std::string> defaults;
+		if (exe.elfclass == ELFCLASS64) defaults = { "/lib64", "/usr/lib64", "/lib", "/usr/lib" };
+		else defaults = { "/lib", "/usr/lib" };
+		re = findInDirs(name, defaults, exe);
+	}
+	return re;
+}
+#endif
+
+std::list<std::string> prefetch::getLibraryClosure(std::string path) {
+	std::list<std::string> re = { path };
+#ifdef HAVE_ELF_H
+	elf_info exe;
+	if (!readElfInfo(path, exe)) return re;
+	if (!exe.interp.empty()) re.push_back(exe.interp);
+	auto env = getenv("LD_LIBRARY_PATH");
+	auto ldpath = env ? splitSearchPath(env, "") : std::list<std::string>();
+	std::list<std::pair<std::string, elf_info>> queue = { std::make_pair(path, exe) };
+	std::list<std::string> names;
+	while (!queue.empty()) {
+		auto cur = queue.front();
+		queue.pop_front();
+		for (auto i = cur.second.needed.begin(); i != cur.second.needed.end(); ++i) {
+			if (std::find(names.begin(), names.end(), *i) != names.end()) continue;
+			names.push_back(*i);
+			auto lib = resolveLibrary(*i, cur.second, exe, ldpath);
+			if (lib.empty()) {
+				console::verbose("Can not resolve shared library %s needed by %s.", i->c_str(), cur.first.c_str());
+				continue;
+			}
+			re.push_back(lib);
+			elf_info info;
+			if (readElfInfo(lib, info)) queue.push_back(std::make_pair(lib, info));
+		}
+	}
+#endif
+	return re;
+}
+
+bool prefetch::readahead(std::string path) {
+#if defined(HAVE_READAHEAD) || defined(HAVE_POSIX_FADVISE)
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+	struct stat st;
+	bool re = false;
+	if (!fstat(fd, &st)) {
+#ifdef HAVE_READAHEAD
+		re = !::readahead(fd, 0, st.st_size);
+#else
+		re = !posix_fadvise(fd, 0, st.st_size, POSIX_FADV_WILLNEED);
+#endif
+	}
+	close(fd);
+	return re;
+#else
+	return false;
+#endif
+}
+
+bool prefetch::isCached(int fd, unsigned long long offset, unsigned long long len) {
+#ifdef HAVE_MINCORE
+	if (!len) return true;
+	auto page = (unsigned long long)sysconf(_SC_PAGESIZE);
+	auto start = offset / page * page;
+	size_t maplen = (size_t)(offset + len - start);
+	auto addr = mmap(nullptr, maplen, PROT_READ, MAP_SHARED, fd, (off_t)start);
+	if (addr == MAP_FAILED) return false;
+	std::vector<unsigned char> vec((maplen + page - 1) / page);
+	bool re = !mincore(addr, maplen, vec.data());
+	for (auto i = vec.begin(); re && i != vec.end(); ++i) {
+		if (!(*i & 1)) re = false;
+	}
+	munmap(addr, maplen);
+	return re;
+#else
+	return false;
+#endif
+}
+
+bool prefetch::media(std::string path, unsigned long long size) {
+#ifdef HAVE_POSIX_FADVISE
+	trace::scope t("prefetch::media", path.c_str());
+	if (!size) return false;
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || !st.st_size) {
+		close(fd);
+		return false;
+	}
+	unsigned long long fsize = st.st_size;
+	unsigned long long head = std::min(size, fsize);
+	unsigned long long tail = fsize > size ? fsize - size : 0;
+	/* Merge head and tail if they overlap. */
+	if (tail <= head) {
+		head = fsize;
+		tail = fsize;
+	}
+	bool re = false;
+	if (isCached(fd, 0, head)) {
+		console::verbose("The head of %s is already in page cache.", path.c_str());
+	} else {
+		re = !posix_fadvise(fd, 0, (off_t)head, POSIX_FADV_WILLNEED);
+	}
+	if (tail < fsize) {
+		if (isCached(fd, tail, fsize - tail)) {
+			console::verbose("The tail of %s is already in page cache.", path.c_str());
+		} else {
+			re = !posix_fadvise(fd, (off_t)tail, (off_t)(fsize - tail), POSIX_FADV_WILLNEED) || re;
+		}
+	}
+	close(fd);
+	if (re) console::verbose("Readahead %llu bytes at the head and tail of %s.", size, path.c_str());
+	return re;
+#else
+	return false;
+#endif
+}
+
+size_t prefetch::executable(std::string path) {
+	trace::scope t("prefetch::executable", path.c_str());
+	auto files = getLibraryClosure(path);
+	size_t count = 0;
+	for (auto i = files.begin(); i != files.end(); ++i) {
+		if (readahead(*i)) count++;
+	}
+	console::verbose("Prefetched %zi files of %s.", count, path.c_str());
+	return count;
+}
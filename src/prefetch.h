@@ -0,0 +1,47 @@
+#ifndef _ST_PREFETCH_H
+#define _ST_PREFETCH_H
+
+#include <list>
+#include <string>
+
+namespace prefetch {
+	/**
+	 * @brief Get the executable and all shared libraries it needs, resolved like the dynamic linker does
+	 * (DT_RPATH, LD_LIBRARY_PATH, DT_RUNPATH, ld.so.cache and default directories).
+	 * Only supported for ELF files, otherwise only the executable itself is returned.
+	 * @param path The path of the executable
+	 * @return the list of files
+	*/
+	std::list<std::string> getLibraryClosure(std::string path);
+	/**
+	 * @brief Ask the kernel to read file into page cache
+	 * @param path The path of file
+	 * @return true if OK
+	*/
+	bool readahead(std::string path);
+	/**
+	 * @brief Check whether a range of file is already in page cache
+	 * @param fd File descriptor
+	 * @param offset Start offset
+	 * @param len The length of range
+	 * @return true if all pages are resident, false if not or unknown
+	*/
+	bool isCached(int fd, unsigned long long offset, unsigned long long len);
+	/**
+	 * @brief Read the head and the tail of a media file into page cache without waiting,
+	 * container headers are at the head and MP4 moov atom is often at the tail.
+	 * The ranges already in page cache are skipped.
+	 * @param path The path of media file
+	 * @param size The size of head and tail in bytes
+	 * @return true if any readahead is issued
+	*/
+	bool media(std::string path, unsigned long long size);
+	/**
+	 * @brief Read executable and all shared libraries it needs into page cache
+	 * @param path The path of the executable
+	 * @return the count of files read
+	*/
+	size_t executable(std::string path);
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include "probecache.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <algorithm>
+#include <list>
+#include "console.h"
+
+#ifdef HAVE_SSCANF_S
+#define sscanf sscanf_s
+#endif
+
+#define PROBE_CACHE_NAME "ffplay.cache"
+
+typedef struct probe_entry {
+	std::string path;
+	fileop::fileid id;
+	unsigned long long caps = 0;
+} probe_entry;
+
+std::string getProbeCachePath() {
+	auto dir = fileop::getCacheDir();
+	if (dir.empty()) return "";
+	return fileop::combilePath(dir, PROBE_CACHE_NAME);
+}
+
+/**
+ * @brief Load all entries from the cache file
+ * @param path The path of the cache file
+ * @param entries Result
+ * @return true if OK
+*/
+bool loadProbeCache(std::string path, std::list<probe_entry>& entries) {
+	std::string data;
+	if (!fileop::readFile(path, data)) return false;
+	size_t start = 0;
+	while (start < data.length()) {
+		auto end = data.find('\n', start);
+		if (end == std::string::npos) end = data.length();
+		auto line = data.substr(start, end - start);
+		start = end + 1;
+		probe_entry e;
+		int n = 0;
+		if (sscanf(line.c_str(), "%llu %llu %llu %lld %llx %n", &e.id.dev, &e.id.ino, &e.id.size, &e.id.mtime, &e.caps, &n) < 5 || n <= 0 || (size_t)n >= line.length()) continue;
+		e.path = line.substr(n);
+		entries.push_back(e);
+	}
+	return true;
+}
+
+bool probecache::lookup(std::string path, const fileop::fileid& id, uint64_t* caps) {
+	auto cpath = getProbeCachePath();
+	if (cpath.empty()) return false;
+	std::list<probe_entry> entries;
+	if (!loadProbeCache(cpath, entries)) return false;
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		if (i->path != path) continue;
+		if (i->id.dev != id.dev || i->id.ino != id.ino || i->id.size != id.size || i->id.mtime != id.mtime) return false;
+		if (caps) *caps = i->caps;
+		return true;
+	}
+	return false;
+}
+
+bool probecache::store(const std::list<entry>& entries) {
+	std::list<const entry*> added;
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		if (i->path.empty() || i->path.find('\n') != std::string::npos) continue;
+		auto path = i->path;
+		if (std::find_if(added.begin(), added.end(), [&path](const entry* e) { return e->path == path; }) != added.end()) continue;
+		added.push_back(&*i);
+	}
+	if (added.empty()) return false;
+	auto cpath = getProbeCachePath();
+	if (cpath.empty()) return false;
+	std::list<probe_entry> old;
+	loadProbeCache(cpath, old);
+	std::string data;
+	char buf[128];
+	for (auto i = old.begin(); i != old.end(); ++i) {
+		auto path = i->path;
+		if (std::find_if(added.begin(), added.end(), [&path](const entry* e) { return e->path == path; }) != added.end()) continue;
+		snprintf(buf, sizeof(buf), "%llu %llu %llu %lld %llx ", i->id.dev, i->id.ino, i->id.size, i->id.mtime, i->caps);
+		data += buf + i->path + "\n";
+	}
+	for (auto i = added.begin(); i != added.end(); ++i) {
+		auto e = *i;
+		snprintf(buf, sizeof(buf), "%llu %llu %llu %lld %llx ", e->id.dev, e->id.ino, e->id.size, e->id.mtime, (unsigned long long)e->caps);
+		data += buf + e->path + "\n";
+	}
+	if (!fileop::writeFile(cpath, data.c_str(), data.length())) return false;
+	for (auto i = added.begin(); i != added.end(); ++i) {
+		console::verbose("Save ffplay probe result to cache: %s", (*i)->path.c_str());
+	}
+	return true;
+}
@@ -0,0 +1,34 @@
+#ifndef _ST_PROBECACHE_H
+#define _ST_PROBECACHE_H
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include "fileop.h"
+
+namespace probecache {
+	typedef struct entry {
+		/// The absolute path of ffplay
+		std::string path;
+		/// The identity of ffplay
+		fileop::fileid id;
+		/// The capabilities of ffplay (see ffcaps::capability)
+		uint64_t caps = 0;
+	} entry;
+	/**
+	 * @brief Check whether ffplay is already known to work
+	 * @param path The absolute path of ffplay
+	 * @param id The identity of ffplay
+	 * @param caps The capabilities of ffplay (see ffcaps::capability). Can be NULL if don't needed.
+	 * @return true if the ffplay with the same identity worked before
+	*/
+	bool lookup(std::string path, const fileop::fileid& id, uint64_t* caps = nullptr);
+	/**
+	 * @brief Remember working ffplay. All entries are written at once, callers should collect results of parallel probes and call this once.
+	 * @param entries Working ffplay, old entries with the same path are replaced
+	 * @return true if OK
+	*/
+	bool store(const std::list<entry>& entries);
+}
+
+#endif
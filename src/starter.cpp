@@ -1,8 +1,24 @@
 #include "starter.h"
 #include <string>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "fileop.h"
 #include "console.h"
 #include "util.h"
+#include "probecache.h"
+#include "ffcaps.h"
+#include "prefetch.h"
+#include "fsinfo.h"
+#include "filtergraph.h"
+#include "assfonts.h"
+#include "subcharset.h"
+#include "pathview.h"
+#include "trace.h"
 
 starter::starter(cml& c, config& cf) {
 	cm = &c;
@@ -10,66 +26,303 @@ starter::starter(cml& c, config& cf) {
 	relativefiles.clear();
 }
 
+starter::~starter() {
+	for (auto i = probes.begin(); i != probes.end(); ++i) {
+		if (i->joinable()) i->join();
+	}
+}
+
 std::string starter::escape(std::string s) {
 	auto t = s;
 	auto npos = std::string::npos;
+	/* Escape for the option value first, the backslashes added here are escaped again for the filtergraph below. */
+	util::strreplace(t, R"(\)", R"(\\)");
+	util::strreplace(t, "'", R"(\')");
+	util::strreplace(t, ":", R"(\:)");
 	if (t.find(',') != npos || t.find('[') != npos || t.find(']') != npos || t.find(';') != npos) {
-		util::strreplace(t, "'", R"(\')");
+		/* Nothing is escaped inside quotes, a quote has to close them, be escaped and open them again. */
+		util::strreplace(t, "'", R"('\'')");
 		t = "'" + t + "'";
-		util::strreplace(t, R"(\)", R"(\\)");
-		util::strreplace(t, ":", R"(\:)");
 	} else {
-		util::strreplace(t, "'", R"(\\\')");
-		util::strreplace(t, R"(\)", R"(\\\\)");
-		util::strreplace(t, ":", R"(\\:)");
+		util::strreplace(t, R"(\)", R"(\\)");
+		util::strreplace(t, "'", R"(\')");
 	}
 	return t;
 }
 
+/**
+ * @brief Results of testing ffplay candidates, shared with probe threads.
+*/
+typedef struct probe_state {
+	std::mutex mutex;
+	std::condition_variable cond;
+	/// 0 means pending, 1 means working, -1 means failed
+	std::vector<int> results;
+	std::vector<uint64_t> caps;
+} probe_state;
+
+/**
+ * @brief Add a working ffplay to the list which will be saved to probe cache
+ * @param path The path to call ffplay
+ * @param caps Capabilities of ffplay (see ffcaps::capability)
+ * @param entries Result
+*/
+static void addProbeEntry(std::string path, uint64_t caps, std::list<probecache::entry>& entries) {
+	probecache::entry e;
+	e.path = fileop::realpath(path);
+	if (e.path.empty() || !fileop::getFileId(e.path, e.id)) return;
+	e.caps = caps;
+	entries.push_back(e);
+}
+
 std::string starter::findFfplay() {
-	if (conf && !conf->ffplay.empty()) {
-		if (testFfplay(conf->ffplay)) {
-			return conf->ffplay;
+	trace::scope t("findFfplay");
+	std::list<std::string> names;
+	if (conf) names = conf->ffplay;
+	names.push_back("ffplay");
+	std::vector<std::string> candidates;
+	for (auto i = names.begin(); i != names.end(); ++i) {
+		if (i->empty()) continue;
+		auto path = fileop::which(*i);
+		if (path.empty()) {
+			console::verbose("Can not find \"%s\" in PATH.", i->c_str());
+			continue;
 		}
+		if (std::find(candidates.begin(), candidates.end(), path) == candidates.end()) candidates.push_back(path);
 	}
-	if (testFfplay("ffplay")) {
-		return "ffplay";
+	/* Candidates after the first cached one never need to be tested. */
+	size_t count = candidates.size();
+	bool cached = false;
+	uint64_t cachedcaps = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (isCachedFfplay(candidates[i], &cachedcaps)) {
+			console::verbose("Find ffplay in probe cache: %s", candidates[i].c_str());
+			count = i + 1;
+			cached = true;
+			break;
+		}
+	}
+	if (count == 0) return "";
+	if (cached && count == 1) {
+		caps = cachedcaps;
+		return candidates[0];
+	}
+	int timeout = conf ? conf->probeTimeout : 3000;
+	auto state = std::make_shared<probe_state>();
+	state->results.resize(count, 0);
+	state->caps.resize(count, 0);
+	if (cached) {
+		state->results[count - 1] = 1;
+		state->caps[count - 1] = cachedcaps;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (state->results[i]) continue;
+		auto path = candidates[i];
+		probes.push_back(std::thread([state, path, i, timeout]() {
+			uint64_t c = 0;
+			bool ok = testFfplay(path, timeout, &c, false);
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->results[i] = ok ? 1 : -1;
+			state->caps[i] = c;
+			state->cond.notify_all();
+		}));
+	}
+	size_t found = count;
+	auto decided = [&]() {
+		for (size_t i = 0; i < count; i++) {
+			if (state->results[i] == 0) return false;
+			if (state->results[i] == 1) {
+				found = i;
+				return true;
+			}
+		}
+		return true;
+	};
+	std::unique_lock<std::mutex> lock(state->mutex);
+	/* Probes kill ffplay after timeout, the extra wait only protects against platforms which can not. */
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout < 0 ? 0 : timeout + 500);
+	if (timeout < 0) {
+		state->cond.wait(lock, decided);
+	} else if (!state->cond.wait_until(lock, deadline, decided)) {
+		console::warn("Testing ffplay takes more than %i ms, give up pending candidates.", timeout);
+		for (size_t i = 0; i < count; i++) {
+			if (state->results[i] == 1) {
+				found = i;
+				break;
+			}
+		}
 	}
-	return "";
+	/* Probes run in parallel, so results are saved here at once instead of racing on the cache file. */
+	std::list<probecache::entry> entries;
+	for (size_t i = 0; i < count; i++) {
+		if (state->results[i] == 1) addProbeEntry(candidates[i], state->caps[i], entries);
+	}
+	std::string result = found < count ? candidates[found] : "";
+	if (found < count) caps = state->caps[found];
+	lock.unlock();
+	if (!entries.empty()) probecache::store(entries);
+	return result;
 }
 
-std::string starter::getAutoExit() {
+std::list<std::string> starter::getArguments(std::string ffplay) {
+	std::list<std::string> args = { ffplay };
+	args.splice(args.end(), getAutoExit());
+	args.splice(args.end(), getVideoFilters());
+	args.splice(args.end(), getWidth());
+	args.splice(args.end(), getProbeOptions());
+	args.push_back(cm->filename);
+	return args;
+}
+
+std::list<std::string> starter::getAutoExit() {
 	if (conf && conf->autoExit) {
-		return " -autoexit";
+		return { "-autoexit" };
 	}
-	return "";
+	return {};
 }
 
-std::string starter::getExternalSubtitles() {
-	std::list<std::string> subs;
-	if (fileop::filterFileListByExt(relativefiles, { "ass" }, subs)) {
-		std::string c = "";
-		for (auto i = subs.begin(); i != subs.end(); ++i) {
-			auto sub = *i;
-			console::info("Add external subtitles: %s", sub.c_str());
-			c += " -vf " + quote("subtitles=" + escape(sub));
+std::list<std::string> starter::getExternalSubtitles() {
+	if (!hasCapability(ffcaps::FILTER_SUBTITLES)) {
+		console::warn("The ffplay is built without subtitles filter (libass), skip external subtitles.");
+		return {};
+	}
+	std::vector<subresolver::candidate> ranked;
+	if (!cm || !subs.resolve(cm->filename, conf, ranked)) {
+		console::verbose("No external subtitles found.");
+		return {};
+	}
+	int max = conf ? conf->maxSubtitles : 1;
+	std::list<std::string> c;
+	for (auto i = ranked.begin(); i != ranked.end(); ++i) {
+		if (max >= 0 && (int)c.size() >= max) {
+			console::verbose("Skip external subtitles because of maxSubtitles: %s", i->path.c_str());
+			continue;
 		}
-		return c;
+		if (!canRender(i->fmt)) {
+			console::verbose("The ffplay can not render %s subtitles: %s", subresolver::toString(i->fmt), i->path.c_str());
+			continue;
+		}
+		console::info("Add external subtitles: %s (%s, score %i)", i->path.c_str(), i->lang.empty() ? "untagged" : i->lang.c_str(), i->score);
+		/* After a timed out scan, subtitles come from the index and reading them may hang like the scan did. */
+		c.push_back(fs.stage && !scanTimedOut ? fsinfo::stage(i->path) : i->path);
 	}
-	console::verbose("Can not filter relative files for subtitles.");
-	return "";
+	return c;
 }
 
-bool starter::getRelativeFiles() {
-	if (cm && !cm->filename.empty()) return fileop::listrelative(cm->filename, relativefiles);
-	return false;
+bool starter::canRender(subresolver::format fmt) {
+	switch (fmt) {
+	case subresolver::ASS:
+		return hasCapability(ffcaps::DECODER_ASS);
+	case subresolver::SSA:
+		return hasCapability(ffcaps::DECODER_SSA) || hasCapability(ffcaps::DECODER_ASS);
+	case subresolver::SRT:
+		return hasCapability(ffcaps::DECODER_SUBRIP);
+	case subresolver::VTT:
+		return hasCapability(ffcaps::DECODER_WEBVTT);
+	default:
+		/* Bitmap subtitles can not be drawn by subtitles filter. */
+		return false;
+	}
+}
+
+bool starter::prepareFonts(std::list<std::string>& subtitles, std::string& fontsdir) {
+	fontsdir.clear();
+	if (!conf || !conf->assFonts || subtitles.empty()) return false;
+	for (auto i = subtitles.begin(); i != subtitles.end(); ++i) {
+		auto ext = pathview(*i).ext();
+		if (!ext.empty()) ext.remove_prefix(1);
+		auto fmt = subresolver::getFormat(ext);
+		/* Fonts of other formats are chosen by libass itself, so they can not be known ahead. */
+		if (fmt != subresolver::ASS && fmt != subresolver::SSA) return false;
+	}
+	auto prepared = subtitles;
+	auto dir = assfonts::find(prepared);
+	if (dir.empty()) {
+		unpreparedFonts = subtitles;
+		return false;
+	}
+	/* libass loads fontconfig's default config otherwise, which scans all fonts on a cold cache. */
+	if (!util::setEnv("FONTCONFIG_FILE", assfonts::getConfigFile(dir))) return false;
+	/* Copies without embedded fonts are only usable with the extracted fonts. */
+	fontsdir = assfonts::getEmbeddedDir(dir);
+	subtitles.swap(prepared);
+	return true;
+}
+
+std::string starter::getCharset(std::string& subtitle) {
+	auto ext = pathview(subtitle).ext();
+	if (!ext.empty()) ext.remove_prefix(1);
+	auto fmt = subresolver::getFormat(ext);
+	if (fmt != subresolver::ASS && fmt != subresolver::SSA && fmt != subresolver::SRT && fmt != subresolver::VTT) return "";
+	std::string charenc;
+	subcharset::prepare(subtitle, charenc, !conf || conf->transcodeSubtitles);
+	return charenc;
+}
+
+std::list<std::string> starter::getVideoFilters() {
+	filtergraph graph;
+	auto subs = getExternalSubtitles();
+	/* Before resolving fonts, which reads font names from UTF-8 copies. Both read subtitles, so are skipped after a timed out scan. */
+	std::list<std::string> charencs;
+	bool converted = true;
+	for (auto i = subs.begin(); i != subs.end(); ++i) {
+		charencs.push_back(scanTimedOut ? "" : getCharset(*i));
+		if (!charencs.back().empty()) converted = false;
+	}
+	std::string fontsdir;
+	/* Font names of a subtitle left in its own encoding can not be read, so libass looks up all fonts itself. */
+	if (!converted) console::verbose("Some subtitles are not converted to UTF-8, do not resolve fonts of subtitles.");
+	else if (!scanTimedOut) prepareFonts(subs, fontsdir);
+	auto enc = charencs.begin();
+	for (auto i = subs.begin(); i != subs.end(); ++i, ++enc) {
+		graph.add(filtergraph::RENDER, "subtitles=" + escape(*i) + (enc->empty() ? "" : ":charenc=" + escape(*enc))
+			+ (fontsdir.empty() ? "" : ":fontsdir=" + escape(fontsdir)));
+	}
+	/* Scale before libass so subtitles are rasterized at output size instead of source size.
+	 * Without anything to render, ffplay scales on the GPU when displaying, which is cheaper. */
+	if (conf && conf->width > 0 && graph.has(filtergraph::RENDER)) {
+		if (hasCapability(ffcaps::FILTER_SCALE)) {
+			graph.add(filtergraph::GEOMETRY, filtergraph::scaleDown(conf->width));
+		} else {
+			console::verbose("The ffplay is built without scale filter, subtitles are rendered at source size.");
+		}
+	}
+	if (graph.empty()) return {};
+	return { "-vf", graph.str() };
+}
+
+std::string starter::getDirectory(const std::string& filename) {
+	auto dir = pathview(filename).dir();
+	return dir.empty() ? "." : pathview::native(dir);
+}
+
+std::list<std::string> starter::getProbeOptions() {
+	std::list<std::string> c;
+	if (!fs.probesize.empty()) {
+		c.push_back("-probesize");
+		c.push_back(fs.probesize);
+	}
+	if (!fs.analyzeduration.empty()) {
+		c.push_back("-analyzeduration");
+		c.push_back(fs.analyzeduration);
+	}
+	return c;
 }
 
-std::string starter::getWidth() {
+std::list<std::string> starter::getWidth() {
 	if (conf && conf->width > 0) {
-		return " -x " + util::itoa(conf->width);
+		return { "-x", util::itoa(conf->width) };
 	}
-	return "";
+	return {};
+}
+
+std::string starter::joinArguments(const std::list<std::string>& args) {
+	std::string s;
+	for (auto i = args.begin(); i != args.end(); ++i) {
+		if (!s.empty()) s += ' ';
+		s += quote(*i);
+	}
+	return s;
 }
 
 std::string starter::quote(std::string s) {
@@ -83,41 +336,214 @@ std::string starter::quote(std::string s) {
 	return s;
 }
 
-int starter::start() {
-	getRelativeFiles();
-	auto ffplay = findFfplay();
+/**
+ * @brief Results of scanning the media file system, shared with the scan thread which may outlive the process after timeout
+*/
+typedef struct start_state {
+	std::string filename;
+	/// A copy, config may be gone when the scan finishes
+	config conf;
+	bool hasConf = false;
+	fsinfo::strategy fs;
+	filelist files;
+	subresolver subs;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool fsready = false;
+	bool done = false;
+	/// Reading the media file ahead finished
+	bool readdone = false;
+} start_state;
+
+/**
+ * @brief Detect the file system of the media file, then list relative files and index subtitles.
+ * Runs on a detached thread, so a dead mount never blocks the process from exiting.
+*/
+void scanMedia(std::shared_ptr<start_state> state) {
+	auto fs = fsinfo::choose(state->filename, state->hasConf ? &state->conf : nullptr);
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->fs = fs;
+		state->fsready = true;
+	}
+	state->cond.notify_all();
+	filelist files;
+	subresolver subs;
+	if (!state->filename.empty()) {
+		fileop::listrelative(state->filename, files, fs.useIndex);
+		subs.add(files);
+		subs.addSubdirectories(starter::getDirectory(state->filename));
+	}
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->files = std::move(files);
+		state->subs = std::move(subs);
+		state->done = true;
+	}
+	state->cond.notify_all();
+}
+
+/**
+ * @brief Read the media file ahead once its file system is known. Runs on a detached thread like scanMedia.
+*/
+void readaheadMedia(std::shared_ptr<start_state> state) {
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->cond.wait(lock, [&state]() { return state->fsready; });
+	auto size = state->fs.readaheadSize;
+	lock.unlock();
+	if (size > 0) prefetch::media(state->filename, (unsigned long long)size * 1024 * 1024);
+	lock.lock();
+	state->readdone = true;
+}
+
+bool starter::abandoned() {
+	if (!media) return false;
+	std::lock_guard<std::mutex> lock(media->mutex);
+	return !media->done || !media->readdone;
+}
+
+int starter::start(taskpool& pool, taskpool::task confready) {
+	if (!cm) return -1;
+	auto begin = std::chrono::steady_clock::now();
+	/* Tasks may still run after start returned, so they must not touch this. */
+	auto filename = cm->filename;
+	auto cf = conf;
+	auto state = std::make_shared<start_state>();
+	state->filename = filename;
+	media = state;
+	/* Not pool tasks: the pool joins its workers at exit, a scan hanging on a dead mount would hang the process. */
+	auto scan = pool.submit([state, cf]() {
+		if (cf) {
+			state->conf = *cf;
+			state->hasConf = true;
+		}
+		std::thread(scanMedia, state).detach();
+		std::thread(readaheadMedia, state).detach();
+	}, { confready });
+	std::string ffplay;
+	auto find = pool.submit([this, &ffplay]() {
+		ffplay = findFfplay();
+	}, { confready });
+	pool.wait(find);
 	if (ffplay.empty()) {
 		console::error("Can not find ffplay.");
 		return -1;
 	}
 	console::info("Find working ffplay: %s", ffplay.c_str());
-	auto s = quote(ffplay);
-	if (!cm) return -1;
-	s += getAutoExit();
-	s += getExternalSubtitles();
-	s += getWidth();
-	s += " " + quote(cm->filename);
-	console::verbose("Start command line: %s", s.c_str());
+	console::verbose("Ffplay capabilities: %s", ffcaps::toString(caps).c_str());
+	if (conf && conf->prefetch) {
+		/* Overlap reading ffplay from disk with the rest of setup. */
+		pool.submit([ffplay]() {
+			prefetch::executable(ffplay);
+		});
+	}
+	pool.wait(confready);
+	/* The budget counts from the start, time spent finding ffplay is included. */
+	int timeout = conf ? conf->scanTimeout : -1;
+	int remain = timeout;
+	if (timeout >= 0) {
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+		remain = elapsed >= timeout ? 0 : timeout - (int)elapsed;
+	}
+	pool.wait(scan);
+	bool done;
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		auto ready = [&state]() { return state->done; };
+		if (remain < 0) state->cond.wait(lock, ready);
+		done = remain < 0 || state->cond.wait_for(lock, std::chrono::milliseconds(remain), ready);
+		/* Detecting file system may hang on a dead mount too. */
+		if (state->fsready) fs = state->fs;
+		if (done) {
+			relativefiles = state->files;
+			subs = state->subs;
+		}
+	}
+	if (!done) {
+		scanTimedOut = true;
+		auto now = trace::now();
+		trace::complete("scanTimeout", now, now, filename.c_str());
+		console::warn("Listing relative files of \"%s\" did not finish in %i ms.", filename.c_str(), timeout);
+		relativefiles.clear();
+		subs.clear();
+		if (fileop::listrelativeCached(filename, relativefiles)) {
+			subs.add(relativefiles);
+			console::warn("Use relative files from directory index, it may be out of date.");
+		} else {
+			console::warn("Start ffplay without external subtitles.");
+		}
+	}
+	std::list<std::string> args;
+	{
+		trace::scope t("getArguments");
+		args = getArguments(ffplay);
+	}
+	/* Loading the system fontconfig config alone takes longer than libass finding fonts itself, so prepare them while ffplay runs. */
+	taskpool::task fonts;
+	if (!unpreparedFonts.empty()) {
+		fonts = pool.submit([subtitles = unpreparedFonts]() mutable {
+			assfonts::prepare(subtitles);
+		});
+	}
+	/* After all cache entries of this run are touched or created, so none of them is removed. */
+	int days = conf ? conf->cacheDays : 30;
+	auto trim = pool.submit([days]() {
+		fileop::trimCache(days);
+	}, { fonts });
+	console::verbose("Start command line: %s", joinArguments(args).c_str());
 	console::info("Starting ffplay.");
-	return fileop::system(s.c_str());
+	if (cm->exec) {
+		/* Nothing runs after exec, the fonts are prepared before it. */
+		pool.wait(trim);
+		trace::instant("launch", "exec");
+		trace::finish();
+		fileop::exec(args);
+		console::error("Can not replace current process with ffplay.");
+		return -1;
+	}
+	/* Only until ffplay is started, waiting for it exit is playback rather than startup. */
+	auto spawnBegin = trace::now();
+	return fileop::spawn(args, [spawnBegin]() {
+		trace::complete("launch", spawnBegin, trace::now(), "spawn");
+	});
 }
 
-bool starter::testFfplay(const char* path) {
+bool starter::testFfplay(const char* path, int timeout, uint64_t* caps, bool remember) {
 	if (!path) return false;
-	return testFfplay(std::string(path));
+	return testFfplay(std::string(path), timeout, caps, remember);
 }
 
-bool starter::testFfplay(std::string path) {
-	auto s = quote(path);
+bool starter::testFfplay(std::string path, int timeout, uint64_t* caps, bool remember) {
+	trace::scope t("testFfplay", path.c_str());
 	console::verbose("Try to find ffplay: %s", path.c_str());
-	s += " -h 2>&0";
-	console::verbose("Test command line: %s", s.c_str());
-	auto f = fileop::popen(s.c_str(), "rb");
-	if (f) {
-		fileop::pclose(f);
-		console::verbose("Find ffplay: %s", path.c_str());
+	if (isCachedFfplay(path, caps)) {
+		console::verbose("Find ffplay in probe cache: %s", path.c_str());
+		return true;
+	}
+	uint64_t c = 0;
+	if (ffcaps::probe(path, timeout, c)) {
+		console::verbose("Find ffplay: %s\nCapabilities: %s", path.c_str(), ffcaps::toString(c).c_str());
+		if (remember) {
+			std::list<probecache::entry> entries;
+			addProbeEntry(path, c, entries);
+			if (!entries.empty()) probecache::store(entries);
+		}
+		if (caps) *caps = c;
 		return true;
 	}
 	console::verbose("Ffplay not find: %s", path.c_str());
 	return false;
 }
+
+bool starter::isCachedFfplay(std::string path, uint64_t* caps) {
+	if (path.find_first_of("/\\") == std::string::npos) return false;
+	auto real = fileop::realpath(path);
+	fileop::fileid id;
+	if (real.empty() || !fileop::getFileId(real, id)) return false;
+	return probecache::lookup(real, id, caps);
+}
+
+bool starter::hasCapability(uint64_t cap) {
+	if (!(caps & ffcaps::PROBED)) return true;
+	return (caps & cap) == cap;
+}
@@ -3,23 +3,51 @@
 
 #include "configfile.h"
 #include "cml.h"
+#include "filelist.h"
+#include "fsinfo.h"
+#include "subresolver.h"
+#include "taskpool.h"
 #include <list>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+struct start_state;
 
 class starter {
 private:
 	cml* cm = nullptr;
 	config* conf = nullptr;
-	std::list<std::string> relativefiles{};
+	filelist relativefiles;
+	/// External subtitles found from relative files and subtitle subdirectories
+	subresolver subs;
+	/// Capabilities of found ffplay, see ffcaps::capability
+	uint64_t caps = 0;
+	/// How to access the media file, decided by its file system
+	fsinfo::strategy fs;
+	/// Listing relative files timed out, the media directory is not touched again
+	bool scanTimedOut = false;
+	/// Subtitles whose fonts are not prepared yet, they are prepared while ffplay runs and used from the next start
+	std::list<std::string> unpreparedFonts;
+	/// Threads testing ffplay candidates, a pending one may outlive findFfplay
+	std::vector<std::thread> probes;
+	/// Shared with the detached threads scanning the media file
+	std::shared_ptr<start_state> media;
 public:
 	starter(cml& c, config& cf);
+	/**
+	 * @brief Wait pending ffplay tests. They are bounded by the probe timeout.
+	*/
+	~starter();
 	/**
 	 * @brief Escape the string
 	 * @param s String
 	 * @return result
 	*/
-	std::string escape(std::string s);
+	static std::string escape(std::string s);
 	/**
-	 * @brief Try to find working ffplay
+	 * @brief Try to find working ffplay. All candidates are tested at the same time, the first working one in config wins.
 	 * @return path if found, otherwise empty string
 	*/
 	std::string findFfplay();
@@ -27,22 +55,62 @@ public:
 	 * @brief Get autoexit option for ffplay
 	 * @return autoexit option for ffplay
 	*/
-	std::string getAutoExit();
+	std::list<std::string> getAutoExit();
+	/**
+	 * @brief Get the best ranked external subtitles which ffplay can render, at most maxSubtitles in config
+	 * @return paths of subtitles, staged to local disk if the file system strategy asks
+	*/
+	std::list<std::string> getExternalSubtitles();
+	/**
+	 * @brief Check whether found ffplay can render a subtitle format with subtitles filter
+	*/
+	bool canRender(subresolver::format fmt);
 	/**
-	 * @brief Get Relative Files
-	 * @return true if OK
+	 * @brief Get the directory of a file, `.` if it has no directory part
 	*/
-	bool getRelativeFiles();
+	static std::string getDirectory(const std::string& filename);
 	/**
-	 * @brief Get all external subtitles from relative files
+	 * @brief Plan the video filtergraph: scaling to the configured width, then rendering external subtitles.
+	 * If all subtitles are ASS, libass is given only their fonts, and FONTCONFIG_FILE is set for ffplay (see assfonts).
 	 * @return vf option for ffplay
 	*/
-	std::string getExternalSubtitles();
+	std::list<std::string> getVideoFilters();
+	/**
+	 * @brief Use the fonts prepared for subtitles (see assfonts), and point FONTCONFIG_FILE to their config.
+	 * If they are not prepared yet, they are saved to unpreparedFonts, resolving them costs more than libass finding them itself.
+	 * @param subtitles External subtitles. Ones with embedded fonts are replaced by copies without them.
+	 * @param fontsdir fontsdir option for the subtitles filter, the extracted embedded fonts. Empty if there are none.
+	 * @return false if subtitles are not all ASS, they are not prepared or it failed
+	*/
+	bool prepareFonts(std::list<std::string>& subtitles, std::string& fontsdir);
+	/**
+	 * @brief Make a text subtitle readable as UTF-8 (see subcharset)
+	 * @param subtitle The subtitle, replaced by a UTF-8 copy if transcodeSubtitles is enabled
+	 * @return charenc option for the subtitles filter, empty if not needed
+	*/
+	std::string getCharset(std::string& subtitle);
+	/**
+	 * @brief Get -probesize and -analyzeduration options chosen by file system strategy
+	 * @return options for ffplay
+	*/
+	std::list<std::string> getProbeOptions();
 	/**
 	 * @brief Get width option for ffplay
 	 * @return width option for ffplay
 	*/
-	std::string getWidth();
+	std::list<std::string> getWidth();
+	/**
+	 * @brief Get the argument list used to start ffplay
+	 * @param ffplay The path to call ffplay
+	 * @return argument list, the first one is ffplay
+	*/
+	std::list<std::string> getArguments(std::string ffplay);
+	/**
+	 * @brief Join argument list to a command line. Only used to display.
+	 * @param args Argument list
+	 * @return the command line
+	*/
+	static std::string joinArguments(const std::list<std::string>& args);
 	/**
 	 * @brief Quote string if string contains space
 	 * @param s the string
@@ -50,22 +118,49 @@ public:
 	*/
 	static std::string quote(std::string s);
 	/**
-	 * @brief Start ffmpeg
+	 * @brief Start ffmpeg. Independent steps run on the pool at the same time.
+	 * @param pool Worker pool
+	 * @param confready The task which loads config, steps need config will wait it.
 	 * @return the return value
 	*/
-	int start();
+	int start(taskpool& pool, taskpool::task confready = nullptr);
+	/**
+	 * @brief Check whether threads scanning the media file are still running, such as on a dead mount.
+	 * They use statics of console, trace and fileop, so the process must not run static destructors then.
+	 * @return true if still running
+	*/
+	bool abandoned();
 	/**
 	 * @brief test ffplay whether to work well
 	 * @param path The path to call ffplay
+	 * @param timeout Timeout in milliseconds, negative means no timeout
+	 * @param caps Capabilities of ffplay (see ffcaps::capability). Can be NULL if don't needed.
+	 * @param remember Save a working ffplay to probe cache
 	 * @return true if work
 	*/
-	static bool testFfplay(const char* path);
+	static bool testFfplay(const char* path, int timeout = -1, uint64_t* caps = nullptr, bool remember = true);
 	/**
 	 * @brief test ffplay whether to work well
 	 * @param path The path to call ffplay
+	 * @param timeout Timeout in milliseconds, negative means no timeout
+	 * @param caps Capabilities of ffplay (see ffcaps::capability). Can be NULL if don't needed.
+	 * @param remember Save a working ffplay to probe cache
 	 * @return true if work
 	*/
-	static bool testFfplay(std::string path);
+	static bool testFfplay(std::string path, int timeout = -1, uint64_t* caps = nullptr, bool remember = true);
+	/**
+	 * @brief Check whether ffplay is already known to work from probe cache
+	 * @param path The absolute path of ffplay
+	 * @param caps Capabilities of ffplay (see ffcaps::capability). Can be NULL if don't needed.
+	 * @return true if known to work
+	*/
+	static bool isCachedFfplay(std::string path, uint64_t* caps = nullptr);
+	/**
+	 * @brief Check whether found ffplay has a capability. Unknown capabilities are treated as supported.
+	 * @param cap Capability, see ffcaps::capability
+	 * @return true if supported or unknown
+	*/
+	bool hasCapability(uint64_t cap);
 };
 
 #endif
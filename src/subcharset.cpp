@@ -0,0 +1,207 @@
+#include "subcharset.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chariconv.h"
+#ifdef HAVE_CHARDET
+#include "chardet.h"
+#endif
+#include "console.h"
+#include "fileop.h"
+#include "pathview.h"
+#include "trace.h"
+#include "util.h"
+
+/// Written in a cache entry for a subtitle in UTF-8
+#define CHARSET_UTF8 "UTF-8"
+/// The max size of a subtitle converted to UTF-8
+#define MAX_TRANSCODE_SIZE (64 * 1024 * 1024)
+/// The size of every part of the sample, see subcharset::readSample
+#define SAMPLE_PART_SIZE (64 * 1024)
+
+bool subcharset::isUTF8(std::string_view data) {
+	auto s = (const unsigned char*)data.data();
+	size_t len = data.length(), i = 0;
+	/* The sample may start in the middle of a sequence. */
+	while (i < len && i < 3 && (s[i] & 0xC0) == 0x80) i++;
+	while (i < len) {
+		unsigned char c = s[i];
+		if (c < 0x80) {
+			if (!c) return false;
+			i++;
+			continue;
+		}
+		size_t n;
+		if (c >= 0xC2 && c <= 0xDF) n = 1;
+		else if (c >= 0xE0 && c <= 0xEF) n = 2;
+		else if (c >= 0xF0 && c <= 0xF4) n = 3;
+		else return false;
+		if (i + n >= len) return true;
+		for (size_t j = 1; j <= n; j++) {
+			if ((s[i + j] & 0xC0) != 0x80) return false;
+		}
+		i += n + 1;
+	}
+	return true;
+}
+
+bool subcharset::readSample(const std::string& path, std::vector<std::string>& parts, size_t part) {
+	auto f = fileop::open(path.c_str(), "rb");
+	if (!f) return false;
+	size_t size = 0;
+	if (!fileop::filesize(f, size)) {
+		fileop::close(f);
+		return false;
+	}
+	size_t offsets[] = { 0, size / 2 - part / 2, size - part };
+	size_t count = size > part * 3 ? 3 : 1;
+	size_t length = count == 3 ? part : size;
+	parts.resize(count);
+	bool ok = true;
+	for (size_t i = 0; i < count && ok; i++) {
+		parts[i].resize(length);
+		ok = !fseek(f, (long)offsets[i], SEEK_SET) && fread(&parts[i][0], 1, length, f) == length;
+	}
+	fileop::close(f);
+	return ok;
+}
+
+static bool isASCII(std::string_view data) {
+	for (auto c : data) {
+		if ((unsigned char)c >= 0x80) return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Get the encoding from BOM
+ * @return encoding name, NULL if no BOM
+*/
+static const char* getBomEncoding(std::string_view s) {
+	if (s.length() >= 3 && !s.compare(0, 3, "\xEF\xBB\xBF")) return CHARSET_UTF8;
+	if (s.length() >= 2 && !s.compare(0, 2, "\xFF\xFE")) return "UTF-16LE";
+	if (s.length() >= 2 && !s.compare(0, 2, "\xFE\xFF")) return "UTF-16BE";
+	return nullptr;
+}
+
+bool subcharset::detect(const std::string& path, std::string& encoding) {
+	trace::scope t("subcharset::detect");
+	std::vector<std::string> parts;
+	if (!readSample(path, parts, SAMPLE_PART_SIZE) || parts.empty()) return false;
+	auto bom = getBomEncoding(parts[0]);
+	if (bom) {
+		encoding = strcmp(bom, CHARSET_UTF8) ? bom : "";
+		return true;
+	}
+	/* Most subtitles are UTF-8, checking it is much cheaper than statistical detection. Valid multi-byte
+	 * sequences are rare in other encodings, but a sample without any non-ASCII byte proves nothing. */
+	bool utf8 = true, ascii = true;
+	for (auto i = parts.begin(); i != parts.end() && utf8; ++i) {
+		utf8 = isUTF8(*i);
+		if (ascii) ascii = isASCII(*i);
+	}
+	if (utf8 && ascii && parts.size() > 1) {
+		std::string data;
+		if (fileop::readFile(path, data, MAX_TRANSCODE_SIZE)) {
+			utf8 = isUTF8(data);
+			parts.assign(1, std::move(data));
+		}
+	}
+	if (utf8) {
+		encoding.clear();
+		return true;
+	}
+#ifdef HAVE_CHARDET
+	/* A line break between parts, so chardet does not see broken sequences as one. */
+	std::string sample;
+	for (auto i = parts.begin(); i != parts.end(); ++i) sample += *i + "\n";
+	char* enc = nullptr;
+	float confidence = 0;
+	short b = -1;
+	if (chardet::det(sample.c_str(), sample.length(), enc, &confidence, b)) {
+		console::verbose("The detect result of \"%s\": %s (confidence: %f)", path.c_str(), enc, confidence);
+		encoding = strcmp(enc, "ASCII") && strcmp(enc, CHARSET_UTF8) ? enc : "";
+		free(enc);
+		return true;
+	}
+#elif defined(_WIN32) && !defined(__CYGWIN__)
+	/* Subtitles not in UTF-8 are usually in the ANSI code page of the user. */
+	auto enc = chariconv::cpToEncoding();
+	if (enc) {
+		console::verbose("This build don't have libchardet, assume \"%s\" is in %s.", path.c_str(), enc);
+		encoding = enc;
+		return true;
+	}
+#endif
+	console::verbose("Can not detect the encoding of \"%s\".", path.c_str());
+	return false;
+}
+
+/**
+ * @brief Get the cache entry of a subtitle, named by its path and identity
+ * @return the path without suffix, empty if failed
+*/
+static std::string getCharsetCachePath(const std::string& path) {
+	fileop::fileid id;
+	if (!fileop::getFileId(path, id)) return "";
+	auto cache = fileop::getCacheDir();
+	if (cache.empty()) return "";
+	uint64_t h = util::fnv1a(FNV1A_INIT, path.c_str(), path.length() + 1);
+	h = util::fnv1a(h, &id.size, sizeof(id.size));
+	h = util::fnv1a(h, &id.mtime, sizeof(id.mtime));
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)h);
+	return fileop::combilePath(fileop::combilePath(cache, "charset"), name);
+}
+
+/**
+ * @brief Write a UTF-8 copy of a subtitle
+ * @return true if OK
+*/
+static bool transcodeTo(const std::string& path, const std::string& encoding, const std::string& copy) {
+	trace::scope t("subcharset::transcode", encoding.c_str());
+	std::string data;
+	if (!fileop::readFile(path, data, MAX_TRANSCODE_SIZE)) return false;
+	char* out = nullptr;
+	size_t outlen = 0;
+	if (!chariconv::convert(data.c_str(), data.length(), out, outlen, encoding.c_str(), CHARSET_UTF8) || !out) return false;
+	bool ok = fileop::writeFile(copy, out, outlen);
+	free(out);
+	return ok;
+}
+
+bool subcharset::prepare(std::string& path, std::string& charenc, bool transcode) {
+	trace::scope t("subcharset::prepare");
+	charenc.clear();
+	auto entry = getCharsetCachePath(path);
+	std::string encoding;
+	bool cached = false;
+	if (!entry.empty() && fileop::readFile(entry, encoding, 256)) {
+		cached = true;
+		fileop::touch(entry);
+	} else {
+		if (!detect(path, encoding)) return false;
+		if (encoding.empty()) encoding = CHARSET_UTF8;
+		/* Checking UTF-8 is cheap if the sample is the whole file, the whole file may be read for bigger ones. */
+		fileop::fileid id;
+		if (encoding == CHARSET_UTF8 && (!fileop::getFileId(path, id) || id.size <= 3 * SAMPLE_PART_SIZE)) return true;
+		if (!entry.empty() && fileop::mkdirs(std::string(pathview(entry).dir()))) fileop::writeFile(entry, encoding.c_str(), encoding.length());
+	}
+	if (encoding == CHARSET_UTF8) return true;
+	if (transcode && !entry.empty()) {
+		auto copy = entry + "-" + std::string(pathview(path).name());
+		if (fileop::touch(copy) || transcodeTo(path, encoding, copy)) {
+			console::verbose("Use UTF-8 copy of \"%s\" (%s): %s", path.c_str(), encoding.c_str(), copy.c_str());
+			path = copy;
+			return true;
+		}
+		console::verbose("Can not convert \"%s\" from %s to UTF-8, let ffplay convert it.", path.c_str(), encoding.c_str());
+	}
+	if (!cached) console::info("Subtitles \"%s\" are in %s.", path.c_str(), encoding.c_str());
+	charenc = encoding;
+	return true;
+}
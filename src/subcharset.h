@@ -0,0 +1,45 @@
+#ifndef _ST_SUBCHARSET_H
+#define _ST_SUBCHARSET_H
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Detect the encoding of text subtitles, so ffplay does not garble ones not in UTF-8
+*/
+namespace subcharset {
+	/**
+	 * @brief Check whether data is UTF-8. A sequence cut at the start or the end is allowed, so a part of a file can be checked.
+	 * @param data Data
+	 * @return false if data contains invalid sequences or NUL (UTF-16 or binary)
+	*/
+	bool isUTF8(std::string_view data);
+	/**
+	 * @brief Read a bounded sample of a file: the head, the middle and the tail, each at most `part` bytes
+	 * @param path The file
+	 * @param parts Result, only the whole file if it is small
+	 * @param part The size of every part
+	 * @return true if OK
+	*/
+	bool readSample(const std::string& path, std::vector<std::string>& parts, size_t part = 64 * 1024);
+	/**
+	 * @brief Detect the encoding of a subtitle from a bounded sample. The whole file is read if the sample is all ASCII.
+	 * @param path The subtitle
+	 * @param encoding Result like GBK, empty if the subtitle is UTF-8 (or ASCII)
+	 * @return false if can not read or detect
+	*/
+	bool detect(const std::string& path, std::string& encoding);
+	/**
+	 * @brief Make a subtitle readable as UTF-8. The detected encoding and the UTF-8 copy are cached by file identity,
+	 * so a subtitle is detected and converted once.
+	 * @param path The subtitle, replaced by a cached UTF-8 copy if transcode is true and converting succeeded
+	 * @param charenc The encoding ffplay should convert from (charenc of the subtitles filter), empty if not needed
+	 * @param transcode Whether to write a UTF-8 copy, or just detect the encoding
+	 * @return false if the encoding is unknown
+	*/
+	bool prepare(std::string& path, std::string& charenc, bool transcode = true);
+}
+
+#endif
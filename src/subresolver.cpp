@@ -0,0 +1,305 @@
+#include "subresolver.h"
+#include <ctype.h>
+#include <algorithm>
+#include "dirscan.h"
+#include "pathview.h"
+#include "util.h"
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#define NATIVE_SEP '\\'
+#else
+#define NATIVE_SEP '/'
+#endif
+
+/// Names of subtitle subdirectories
+static const char* subdirectories[] = { "Subs", "Subtitles" };
+
+/// Language names and ISO 639-2 codes used in subtitle file names, mapped to ISO 639-1 codes
+static const char* languages[][2] = {
+	{ "english", "en" }, { "eng", "en" },
+	{ "chinese", "zh" }, { "chi", "zh" }, { "zho", "zh" }, { "chs", "zh-hans" }, { "cht", "zh-hant" },
+	{ "japanese", "ja" }, { "jpn", "ja" },
+	{ "korean", "ko" }, { "kor", "ko" },
+	{ "french", "fr" }, { "fre", "fr" }, { "fra", "fr" },
+	{ "german", "de" }, { "ger", "de" }, { "deu", "de" },
+	{ "spanish", "es" }, { "spa", "es" },
+	{ "portuguese", "pt" }, { "por", "pt" },
+	{ "italian", "it" }, { "ita", "it" },
+	{ "russian", "ru" }, { "rus", "ru" },
+	{ "arabic", "ar" }, { "ara", "ar" },
+	{ "dutch", "nl" }, { "dut", "nl" }, { "nld", "nl" },
+	{ "polish", "pl" }, { "pol", "pl" },
+	{ "turkish", "tr" }, { "tur", "tr" },
+	{ "swedish", "sv" }, { "swe", "sv" },
+	{ "norwegian", "no" }, { "nor", "no" },
+	{ "danish", "da" }, { "dan", "da" },
+	{ "finnish", "fi" }, { "fin", "fi" },
+	{ "greek", "el" }, { "gre", "el" }, { "ell", "el" },
+	{ "hebrew", "he" }, { "heb", "he" },
+	{ "czech", "cs" }, { "cze", "cs" }, { "ces", "cs" },
+	{ "hungarian", "hu" }, { "hun", "hu" },
+	{ "romanian", "ro" }, { "rum", "ro" }, { "ron", "ro" },
+	{ "ukrainian", "uk" }, { "ukr", "uk" },
+	{ "thai", "th" }, { "tha", "th" },
+	{ "vietnamese", "vi" }, { "vie", "vi" },
+	{ "indonesian", "id" }, { "ind", "id" },
+	{ "hindi", "hi" }, { "hin", "hi" },
+};
+
+/**
+ * @brief Get the language code of a language tag, so `English` and `eng` match `en`
+ * @param tag The tag
+ * @return lower case ISO 639-1 code if known, otherwise the lower case tag
+*/
+static std::string normalizeLanguage(std::string_view tag) {
+	for (auto& l : languages) {
+		if (util::equalsIgnoreCase(tag, l[0])) return l[1];
+	}
+	return util::toLower(tag);
+}
+
+subresolver::format subresolver::getFormat(std::string_view ext) {
+	if (util::equalsIgnoreCase(ext, "ass")) return ASS;
+	if (util::equalsIgnoreCase(ext, "ssa")) return SSA;
+	if (util::equalsIgnoreCase(ext, "srt")) return SRT;
+	if (util::equalsIgnoreCase(ext, "vtt")) return VTT;
+	if (util::equalsIgnoreCase(ext, "sup")) return SUP;
+	return FORMAT_UNKNOWN;
+}
+
+const char* subresolver::toString(format f) {
+	switch (f) {
+	case ASS:
+		return "ass";
+	case SSA:
+		return "ssa";
+	case SRT:
+		return "srt";
+	case VTT:
+		return "vtt";
+	case SUP:
+		return "sup";
+	default:
+		return "unknown";
+	}
+}
+
+std::string_view subresolver::getKey(const record& r) const {
+	auto path = paths[r.index];
+	return path.substr(r.key);
+}
+
+void subresolver::addFile(std::string_view dir, std::string_view key, bool subdir) {
+	auto ext = pathview(key).ext();
+	if (ext.empty()) return;
+	auto fmt = getFormat(ext.substr(1));
+	if (fmt == FORMAT_UNKNOWN) return;
+	if (!paths.push_back(dir, key)) return;
+	record r;
+	r.index = (uint32_t)(paths.size() - 1);
+	r.key = (uint32_t)dir.length();
+	r.fmt = fmt;
+	r.subdir = subdir;
+	items.push_back(r);
+	sorted = false;
+}
+
+void subresolver::sort() {
+	if (sorted) return;
+	std::stable_sort(items.begin(), items.end(), [this](const record& a, const record& b) {
+		return getKey(a) < getKey(b);
+	});
+	sorted = true;
+}
+
+void subresolver::clear() {
+	paths.clear();
+	items.clear();
+	sorted = true;
+}
+
+bool subresolver::scanSubdirectory(const std::string& dir) {
+	dirscan scanner;
+	if (!scanner.scan(dir)) return false;
+	auto& base = scanner.directory();
+	auto& entries = scanner.entries();
+	std::string key;
+	/* Reused, so its arena is allocated once. */
+	dirscan inner;
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		if (i->type == dirscan::DIRECTORY || (i->type == dirscan::UNKNOWN && pathview(i->name).ext().empty())) {
+			/* Subs/<stem>/<language>.srt */
+			if (!inner.scan(base + std::string(i->name))) continue;
+			auto& files = inner.entries();
+			for (auto j = files.begin(); j != files.end(); ++j) {
+				key.assign(i->name);
+				key += NATIVE_SEP;
+				key += j->name;
+				addFile(base, key, true);
+			}
+		} else {
+			addFile(base, i->name, true);
+		}
+	}
+	return true;
+}
+
+bool subresolver::build(std::string dir) {
+	dirscan scanner;
+	if (!scanner.scan(dir)) return false;
+	auto& base = scanner.directory();
+	auto& entries = scanner.entries();
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		bool isdir = false;
+		for (auto name : subdirectories) {
+			if (util::equalsIgnoreCase(i->name, name)) isdir = true;
+		}
+		if (isdir && i->type != dirscan::FILE) scanSubdirectory(base + std::string(i->name));
+		else addFile(base, i->name, false);
+	}
+	sort();
+	return true;
+}
+
+void subresolver::add(const filelist& fl) {
+	for (size_t i = 0; i < fl.size(); i++) {
+		pathview p(fl[i]);
+		addFile(p.dir(), p.name(), false);
+	}
+	sort();
+}
+
+void subresolver::addSubdirectories(std::string dir) {
+	if (dir.empty()) return;
+	if (!pathview::isSeparator(dir.back())) dir += NATIVE_SEP;
+	for (auto name : subdirectories) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+		scanSubdirectory(dir + name);
+#else
+		/* Lower case names are common too. Only tried if not found, so case insensitive file systems (macOS) list it once. */
+		if (!scanSubdirectory(dir + name)) scanSubdirectory(dir + util::toLower(name));
+#endif
+	}
+	sort();
+}
+
+/**
+ * @brief Parse tags like `en.forced` of a candidate
+*/
+static void parseTags(std::string_view tags, subresolver::candidate& c) {
+	while (!tags.empty()) {
+		auto end = tags.find('.');
+		auto tag = tags.substr(0, end);
+		tags = end == std::string_view::npos ? std::string_view() : tags.substr(end + 1);
+		/* Track files like `2_English` are numbered. */
+		size_t digits = 0;
+		while (digits < tag.length() && isdigit((unsigned char)tag[digits])) digits++;
+		if (digits && digits < tag.length() && tag[digits] == '_') tag.remove_prefix(digits + 1);
+		if (tag.empty()) continue;
+		if (util::equalsIgnoreCase(tag, "forced")) {
+			c.forced = true;
+		} else if (util::equalsIgnoreCase(tag, "sdh") || util::equalsIgnoreCase(tag, "cc")) {
+			c.sdh = true;
+		} else if (util::equalsIgnoreCase(tag, "hi") && !c.lang.empty()) {
+			/* `en.hi` is for the hearing impaired, a lone `hi` is Hindi. */
+			c.sdh = true;
+		} else if (util::equalsIgnoreCase(tag, "default")) {
+			continue;
+		} else if (c.lang.empty()) {
+			c.lang = normalizeLanguage(tag);
+		}
+	}
+}
+
+/**
+ * @brief Check whether a language tag matches a preferred language, `zh` matches `zh-hans` and `zh_cn`
+*/
+static bool matchLanguage(const std::string& lang, const std::string& prefer) {
+	if (prefer.length() > lang.length()) return false;
+	if (!util::equalsIgnoreCase(std::string_view(lang).substr(0, prefer.length()), prefer)) return false;
+	return prefer.length() == lang.length() || lang[prefer.length()] == '-' || lang[prefer.length()] == '_';
+}
+
+/**
+ * @brief Score a candidate
+ * @param languages Normalized preferred languages (see normalizeLanguage)
+*/
+static int getScore(const subresolver::candidate& c, const config* conf, const std::vector<std::string>& languages) {
+	static const config defaults;
+	if (!conf) conf = &defaults;
+	auto& w = conf->subtitleScore;
+	int score = 0;
+	switch (c.fmt) {
+	case subresolver::ASS:
+		score += w.ass;
+		break;
+	case subresolver::SSA:
+		score += w.ssa;
+		break;
+	case subresolver::SRT:
+		score += w.srt;
+		break;
+	case subresolver::VTT:
+		score += w.vtt;
+		break;
+	case subresolver::SUP:
+		score += w.sup;
+		break;
+	default:
+		break;
+	}
+	score += c.subdir ? w.subdirectory : w.sameDirectory;
+	if (c.forced) score += w.forced;
+	if (c.sdh) score += w.sdh;
+	if (c.lang.empty()) {
+		score += w.untagged;
+	} else {
+		/* Earlier preferred languages get more. */
+		int rank = (int)languages.size();
+		for (auto i = languages.begin(); i != languages.end(); ++i, rank--) {
+			if (matchLanguage(c.lang, *i)) {
+				score += w.language * rank;
+				break;
+			}
+		}
+	}
+	return score;
+}
+
+bool subresolver::resolve(std::string_view video, const config* conf, std::vector<candidate>& result) const {
+	result.clear();
+	auto stem = pathview(video).nameStem();
+	if (stem.empty()) return false;
+	std::vector<std::string> languages;
+	if (conf) {
+		for (auto i = conf->subtitleLanguages.begin(); i != conf->subtitleLanguages.end(); ++i) languages.push_back(normalizeLanguage(*i));
+	}
+	auto first = std::lower_bound(items.begin(), items.end(), stem, [this](const record& r, std::string_view s) {
+		return getKey(r) < s;
+	});
+	for (auto i = first; i != items.end(); ++i) {
+		auto key = getKey(*i);
+		if (key.compare(0, stem.length(), stem)) break;
+		if (key.length() <= stem.length()) continue;
+		char next = key[stem.length()];
+		candidate c;
+		if (next == '.') {
+			/* Tags are between the stem and the ext. */
+			auto ext = pathview(key).extPosition();
+			if (ext > stem.length()) parseTags(key.substr(stem.length() + 1, ext - stem.length() - 1), c);
+		} else if (pathview::isSeparator(next) && i->subdir) {
+			parseTags(pathview(key.substr(stem.length() + 1)).stem(), c);
+		} else {
+			continue;
+		}
+		c.path = paths[i->index];
+		c.fmt = i->fmt;
+		c.subdir = i->subdir;
+		c.score = getScore(c, conf, languages);
+		result.push_back(std::move(c));
+	}
+	std::stable_sort(result.begin(), result.end(), [](const candidate& a, const candidate& b) {
+		return a.score > b.score;
+	});
+	return !result.empty();
+}
@@ -0,0 +1,101 @@
+#ifndef _ST_SUBRESOLVER_H
+#define _ST_SUBRESOLVER_H
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "configfile.h"
+#include "filelist.h"
+
+/**
+ * @brief Find and rank external subtitles of videos.
+ * Subtitle files of a directory and its `Subs/` and `Subtitles/` subdirectories are indexed once,
+ * sorted by their names relative to the directory. Resolving a video is a binary search by its stem,
+ * so every video of a directory can be resolved with one index.
+ * Matched names are `<stem>.<tags>.<ext>`, such as `movie.en.forced.srt`, and `<stem>/<name>.<ext>` in subdirectories.
+*/
+class subresolver {
+public:
+	enum format : unsigned char {
+		FORMAT_UNKNOWN,
+		ASS,
+		SSA,
+		SRT,
+		VTT,
+		/// PGS bitmap subtitles
+		SUP,
+	};
+	typedef struct candidate {
+		std::string path;
+		format fmt = FORMAT_UNKNOWN;
+		/// Language tag in lower case, empty if not tagged
+		std::string lang;
+		/// Only contains forced (foreign parts) lines
+		bool forced = false;
+		/// For the deaf and hard of hearing
+		bool sdh = false;
+		/// Found in a subtitle subdirectory
+		bool subdir = false;
+		int score = 0;
+	} candidate;
+	/**
+	 * @brief Index subtitles of a directory and its subtitle subdirectories
+	 * @param dir The directory
+	 * @return false if the directory can not be listed
+	*/
+	bool build(std::string dir);
+	/**
+	 * @brief Add files of a directory, files which are not subtitles are ignored.
+	 * Used with the relative files from fileop::listrelative instead of listing the whole directory.
+	 * @param fl Full paths, all in one directory
+	*/
+	void add(const filelist& fl);
+	/**
+	 * @brief Index subtitle subdirectories of a directory only
+	 * @param dir The directory
+	*/
+	void addSubdirectories(std::string dir);
+	/**
+	 * @brief Remove all indexed subtitles
+	*/
+	void clear();
+	/**
+	 * @brief Get the count of indexed subtitles
+	*/
+	size_t size() const {
+		return items.size();
+	}
+	/**
+	 * @brief Find subtitles of a video and rank them
+	 * @param video The path of video, only its file name is used
+	 * @param conf Config with scoring model, can be NULL to use defaults
+	 * @param result Candidates, the best first. Cleared first.
+	 * @return true if any subtitle is found
+	*/
+	bool resolve(std::string_view video, const config* conf, std::vector<candidate>& result) const;
+	/**
+	 * @brief Get the format of an ext
+	 * @param ext Ext without `.`, case insensitive
+	*/
+	static format getFormat(std::string_view ext);
+	static const char* toString(format f);
+private:
+	typedef struct record {
+		/// Index in paths
+		uint32_t index;
+		/// Offset of the key in the path. Key is the name relative to the indexed directory.
+		uint32_t key;
+		format fmt;
+		bool subdir;
+	} record;
+	filelist paths;
+	std::vector<record> items;
+	bool sorted = true;
+	std::string_view getKey(const record& r) const;
+	void addFile(std::string_view dir, std::string_view key, bool subdir);
+	void sort();
+	bool scanSubdirectory(const std::string& dir);
+};
+
+#endif
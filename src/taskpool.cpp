@@ -0,0 +1,65 @@
+#include "taskpool.h"
+
+taskpool::taskpool(size_t threads) {
+	if (!threads) threads = 1;
+	for (size_t i = 0; i < threads; i++) {
+		workers.push_back(std::thread(&taskpool::worker, this));
+	}
+}
+
+taskpool::~taskpool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cond.notify_all();
+	for (auto i = workers.begin(); i != workers.end(); ++i) {
+		i->join();
+	}
+}
+
+taskpool::task taskpool::submit(std::function<void()> func, std::list<task> deps) {
+	auto t = std::make_shared<node>();
+	t->func = func;
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto i = deps.begin(); i != deps.end(); ++i) {
+		if (!*i || (*i)->done) continue;
+		(*i)->dependents.push_back(t);
+		t->pending++;
+	}
+	if (!t->pending) {
+		ready.push_back(t);
+		cond.notify_one();
+	}
+	return t;
+}
+
+void taskpool::wait(task t) {
+	if (!t) return;
+	std::unique_lock<std::mutex> lock(mutex);
+	donecond.wait(lock, [&t]() { return t->done; });
+}
+
+void taskpool::worker() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		/* Pending tasks are still run when stopping, a task never waits forever. */
+		cond.wait(lock, [this]() { return stopping || !ready.empty(); });
+		if (ready.empty()) return;
+		auto t = ready.front();
+		ready.pop_front();
+		lock.unlock();
+		if (t->func) t->func();
+		lock.lock();
+		t->done = true;
+		t->func = nullptr;
+		for (auto i = t->dependents.begin(); i != t->dependents.end(); ++i) {
+			if (!--(*i)->pending) {
+				ready.push_back(*i);
+				cond.notify_one();
+			}
+		}
+		t->dependents.clear();
+		donecond.notify_all();
+	}
+}
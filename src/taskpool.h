@@ -0,0 +1,58 @@
+#ifndef _ST_TASKPOOL_H
+#define _ST_TASKPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class taskpool {
+public:
+	class node;
+	typedef std::shared_ptr<node> task;
+	/**
+	 * @brief A task in task graph
+	*/
+	class node {
+	public:
+		std::function<void()> func;
+		/// The count of dependencies not finished
+		size_t pending = 0;
+		bool done = false;
+		std::list<task> dependents;
+	};
+	/**
+	 * @brief Create a fixed worker pool
+	 * @param threads The count of worker threads
+	*/
+	taskpool(size_t threads);
+	/**
+	 * @brief Wait all submitted tasks and stop workers
+	*/
+	~taskpool();
+	/**
+	 * @brief Submit a task, it will be run after all dependencies finished
+	 * @param func The function
+	 * @param deps Dependencies, null tasks are ignored
+	 * @return the task
+	*/
+	task submit(std::function<void()> func, std::list<task> deps = {});
+	/**
+	 * @brief Wait a task finished
+	 * @param t The task, return immediately if null
+	*/
+	void wait(task t);
+private:
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::condition_variable donecond;
+	std::list<task> ready;
+	std::vector<std::thread> workers;
+	bool stopping = false;
+	void worker();
+};
+
+#endif
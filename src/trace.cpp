@@ -0,0 +1,128 @@
+#include "trace.h"
+#ifdef HAVE_ST_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+#include "fileop.h"
+#include "console.h"
+
+typedef struct trace_event {
+	const char* name;
+	uint64_t ts;
+	uint64_t dur;
+	bool instant;
+	int tid;
+	std::string detail;
+} trace_event;
+
+std::atomic<bool> trace::enabled(false);
+static std::mutex trace_mutex;
+static std::vector<trace_event> trace_events;
+static std::string trace_file;
+static std::atomic<int> trace_tid_count(0);
+
+/**
+ * @brief Small sequential thread id which is easy to read in trace viewer
+*/
+int getTraceTid() {
+	thread_local int tid = ++trace_tid_count;
+	return tid;
+}
+
+void trace::start(std::string file) {
+	if (file.empty()) return;
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	trace_file = file;
+	trace_events.reserve(64);
+	enabled = true;
+}
+
+uint64_t trace::now() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void trace::complete(const char* name, uint64_t begin, uint64_t end, const char* detail) {
+	if (!enabled || !name) return;
+	trace_event e;
+	e.name = name;
+	e.ts = begin;
+	e.dur = end > begin ? end - begin : 0;
+	e.instant = false;
+	e.tid = getTraceTid();
+	if (detail) e.detail = detail;
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	if (enabled) trace_events.push_back(e);
+}
+
+void trace::instant(const char* name, const char* detail) {
+	if (!enabled || !name) return;
+	trace_event e;
+	e.name = name;
+	e.ts = now();
+	e.dur = 0;
+	e.instant = true;
+	e.tid = getTraceTid();
+	if (detail) e.detail = detail;
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	if (enabled) trace_events.push_back(e);
+}
+
+/**
+ * @brief Escape string for JSON
+*/
+std::string jsonEscape(const std::string& s) {
+	std::string re;
+	char buf[8];
+	for (auto i = s.begin(); i != s.end(); ++i) {
+		unsigned char c = *i;
+		if (c == '"' || c == '\\') {
+			re += '\\';
+			re += c;
+		} else if (c < 0x20) {
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			re += buf;
+		} else {
+			re += c;
+		}
+	}
+	return re;
+}
+
+bool trace::finish() {
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	if (!enabled) return false;
+	enabled = false;
+	std::string data = "{\"traceEvents\":[";
+	char buf[128];
+	int pid = getpid();
+	for (auto i = trace_events.begin(); i != trace_events.end(); ++i) {
+		if (i != trace_events.begin()) data += ",";
+		data += "\n{\"name\":\"" + jsonEscape(i->name) + "\",\"cat\":\"startup\"";
+		if (i->instant) {
+			/* Thread scoped instant event */
+			snprintf(buf, sizeof(buf), ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":%d,\"tid\":%d", (unsigned long long)i->ts, pid, i->tid);
+		} else {
+			snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%d,\"tid\":%d", (unsigned long long)i->ts, (unsigned long long)i->dur, pid, i->tid);
+		}
+		data += buf;
+		if (!i->detail.empty()) data += ",\"args\":{\"detail\":\"" + jsonEscape(i->detail) + "\"}";
+		data += "}";
+	}
+	data += "\n],\"displayTimeUnit\":\"ms\"}\n";
+	trace_events.clear();
+	if (!fileop::writeFile(trace_file, data.c_str(), data.length())) {
+		console::warn("Can not write trace file \"%s\".", trace_file.c_str());
+		return false;
+	}
+	console::verbose("Write trace to \"%s\".", trace_file.c_str());
+	return true;
+}
@@ -0,0 +1,65 @@
+#ifndef _ST_TRACE_H
+#define _ST_TRACE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+namespace trace {
+	/// Whether tracing is enabled, only changed by start and finish
+	extern std::atomic<bool> enabled;
+	/**
+	 * @brief Enable tracing, events are written to file when calling finish.
+	 * @param file The path of output file (Chrome trace event JSON)
+	*/
+	void start(std::string file);
+	/**
+	 * @brief Get current timestamp used in trace
+	 * @return timestamp in microseconds
+	*/
+	uint64_t now();
+	/**
+	 * @brief Record a finished phase
+	 * @param name Phase name, must be a string literal
+	 * @param begin Begin timestamp from now()
+	 * @param end End timestamp from now()
+	 * @param detail Detail information, can be NULL
+	*/
+	void complete(const char* name, uint64_t begin, uint64_t end, const char* detail = nullptr);
+	/**
+	 * @brief Record a point in time which has no duration
+	 * @param name Event name, must be a string literal
+	 * @param detail Detail information, can be NULL
+	*/
+	void instant(const char* name, const char* detail = nullptr);
+	/**
+	 * @brief Write all recorded events to file and stop tracing
+	 * @return true if OK
+	*/
+	bool finish();
+	/**
+	 * @brief Record the time between construction and destruction as a phase. Do nothing if tracing is disabled.
+	*/
+	class scope {
+	public:
+		/**
+		 * @param name Phase name, must be a string literal
+		 * @param detail Detail information, can be NULL
+		*/
+		scope(const char* name, const char* detail = nullptr) {
+			if (!enabled.load(std::memory_order_relaxed)) return;
+			this->name = name;
+			if (detail) this->detail = detail;
+			begin = now();
+		}
+		~scope() {
+			if (name) complete(name, begin, now(), detail.empty() ? nullptr : detail.c_str());
+		}
+	private:
+		const char* name = nullptr;
+		std::string detail;
+		uint64_t begin = 0;
+	};
+}
+
+#endif
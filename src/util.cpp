@@ -1,8 +1,10 @@
 #include "util.h"
 #include <malloc.h>
 #include "console.h"
+#include <ctype.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #include <windows.h>
 #endif
@@ -238,6 +240,37 @@ void util::strreplace(std::string& str, std::string pattern, std::string value)
 	}
 }
 
+bool util::equalsIgnoreCase(std::string_view a, std::string_view b) {
+	if (a.length() != b.length()) return false;
+	for (size_t i = 0; i < a.length(); i++) {
+		if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+	}
+	return true;
+}
+
+std::string util::toLower(std::string_view s) {
+	std::string re(s);
+	for (auto& c : re) c = (char)tolower((unsigned char)c);
+	return re;
+}
+
+uint64_t util::fnv1a(uint64_t hash, const void* data, size_t len) {
+	auto p = (const unsigned char*)data;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool util::setEnv(const char* name, const std::string& value) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	return !_putenv_s(name, value.c_str());
+#else
+	return value.empty() ? !unsetenv(name) : !setenv(name, value.c_str(), 1);
+#endif
+}
+
 #if defined(_WIN32) && !defined(__CYGWIN__)
 /**
  * @brief Convert wstring version argv to UTF-8 encoding argv
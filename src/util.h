@@ -9,7 +9,13 @@
 #include "pcre.h"
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
+#include <string_view>
+
+/// Initial value of util::fnv1a
+#define FNV1A_INIT 14695981039346656037ULL
 
 namespace util {
 #ifdef HAVE_PCRE
@@ -89,6 +95,30 @@ namespace util {
 	 * @param value replace value
 	*/
 	void strreplace(std::string& str, std::string pattern, std::string value);
+	/**
+	 * @brief Compare strings ignoring case (Only safe with ASCII)
+	 * @return true if equal
+	*/
+	bool equalsIgnoreCase(std::string_view a, std::string_view b);
+	/**
+	 * @brief Convert string to lowercase (Only safe with ASCII)
+	*/
+	std::string toLower(std::string_view s);
+	/**
+	 * @brief Feed data to a 64-bit FNV-1a hash, used to name cache files
+	 * @param hash Current hash, FNV1A_INIT to start a new one
+	 * @param data Data
+	 * @param len The length of data in bytes
+	 * @return the new hash
+	*/
+	uint64_t fnv1a(uint64_t hash, const void* data, size_t len);
+	/**
+	 * @brief Set an environment variable of current process, inherited by programs started later
+	 * @param name The name
+	 * @param value The value, empty to remove the variable
+	 * @return true if OK
+	*/
+	bool setEnv(const char* name, const std::string& value);
 #if defined(_WIN32) && !defined(__CYGWIN__)
 	/**
 	 * @brief Get unicode version argv by using win api